@@ -0,0 +1,360 @@
+// Benchmarks for the gossip simulations.
+//
+// Micro part: times the hot paths of the simulations in isolation (share naming
+// and interning, the per-node seen table, event scheduling, topology
+// construction, the receive path). They are the simulations' own functions from
+// gossip/hot-path.h, not copies.
+// Macro part: runs the simulation binaries end-to-end with fixed seeds at
+// several network sizes and records wall time, event rate and peak RSS.
+//
+// Results are written as JSON so runs can be compared over time:
+//   ./ns3 run "scratch/GossipBenchmark --sizes=1000,10000 --out=bench.json"
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <glob.h>
+#include <signal.h>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "gossip/hot-path.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("GossipBenchmark");
+
+struct MicroResult {
+    std::string name;
+    uint64_t iterations;
+    double nsPerOp;
+};
+
+struct MacroResult {
+    std::string sim;
+    uint32_t nodes;
+    uint32_t seed;
+    double wallSeconds = 0.0;
+    uint64_t events = 0;
+    double simSeconds = 0.0;
+    long peakRssKb = 0;
+    int exitStatus = -1;
+    bool timedOut = false;
+};
+
+// Keeps the optimizer from discarding the benchmarked work
+static volatile uint64_t g_sink = 0;
+
+static double ElapsedNs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Same arguments as GossipApp::ReceiveShare in ScheduleWithContext
+static void NoOpDelivery(uint32_t receiver, uint32_t sender, uint32_t share, uint32_t hopCount, uint64_t deliveryId) {
+    g_sink += receiver + share + deliveryId;
+}
+
+// ---------------------------------------------------------------------------
+// Micro benchmarks
+// ---------------------------------------------------------------------------
+
+static std::vector<MicroResult> RunMicro(uint64_t iterations, uint32_t numNodes, uint32_t numPeers) {
+    std::vector<MicroResult> results;
+
+    std::vector<std::string> names;
+    names.reserve(iterations);
+    for (uint64_t i = 0; i < iterations; i++) {
+        names.push_back(BlockName(i / numNodes, i % numNodes));
+    }
+
+    // MinerApp::MineBlock in Gossip_with_miners and MinerApp::MineShare in ScheduleWithContext
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; i++) {
+            g_sink += BlockName(i / numNodes, i % numNodes).size();
+        }
+        results.push_back({"block_name", iterations, ElapsedNs(start) / iterations});
+
+        start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; i++) {
+            g_sink += ShareName(i % numNodes, i * 0.001).size();
+        }
+        results.push_back({"share_name", iterations, ElapsedNs(start) / iterations});
+    }
+
+    // Every share that arrives is interned before the seen tables are consulted;
+    // known names are what duplicate receives cost
+    {
+        ShareIds ids;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& name : names) {
+            g_sink += ids.Intern(name);
+        }
+        results.push_back({"intern_new", iterations, ElapsedNs(start) / iterations});
+
+        start = std::chrono::steady_clock::now();
+        for (const auto& name : names) {
+            g_sink += ids.Intern(name);
+        }
+        results.push_back({"intern_known", iterations, ElapsedNs(start) / iterations});
+    }
+
+    // One node's seen table
+    {
+        SeenShares seen;
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; i++) {
+            g_sink += seen.Insert(i);
+        }
+        results.push_back({"seen_insert", iterations, ElapsedNs(start) / iterations});
+
+        // Half hits, half misses, roughly what a node sees while flooding
+        start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; i++) {
+            g_sink += seen.Contains(i % 2 == 0 ? i : i + iterations);
+        }
+        results.push_back({"seen_lookup", iterations, ElapsedNs(start) / iterations});
+    }
+
+    // Schedule + execute, with delays in the range the gossip code uses
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; i++) {
+            Simulator::ScheduleWithContext(i % numNodes, Seconds(0.05 + (double)(rand() % 1000) / 1000.0), &NoOpDelivery,
+                                           static_cast<uint32_t>(i % numNodes), 0u, static_cast<uint32_t>(i), 1u, uint64_t(0));
+        }
+        Simulator::Run();
+        results.push_back({"event_schedule_run", iterations, ElapsedNs(start) / iterations});
+        Simulator::Destroy();
+    }
+
+    {
+        auto start = std::chrono::steady_clock::now();
+        g_sink += BuildTopology(numNodes, numPeers).size();
+        results.push_back({"build_topology", numNodes, ElapsedNs(start) / numNodes});
+    }
+
+    // TcpGossipApp::ReceiveMessage and HandleFrame: bytes into the connection
+    // buffer, frames out, then the dedup check of a first receive
+    {
+        std::vector<Ptr<Packet>> packets;
+        uint64_t count = std::min<uint64_t>(iterations, 100000);
+        for (uint64_t i = 0; i < count; i++) {
+            std::string msg = names[i] + "\n";
+            packets.push_back(Create<Packet>((uint8_t *)msg.c_str(), msg.size()));
+        }
+        ShareIds ids;
+        SeenShares seen;
+
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& packet : packets) {
+            std::string buffer;
+            AppendPayload(buffer, packet);
+            for (const auto& frame : TakeFrames(buffer)) {
+                g_sink += seen.Insert(ids.Intern(frame));
+            }
+        }
+        results.push_back({"receive_frames", count, ElapsedNs(start) / count});
+    }
+
+    return results;
+}
+
+// ---------------------------------------------------------------------------
+// Macro benchmarks
+// ---------------------------------------------------------------------------
+
+static std::vector<std::string> Split(const std::string& s, char sep) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, sep)) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+// Runs one simulation binary and scans its stdout for the summary lines
+static MacroResult RunMacro(const std::string& binary, const std::string& sim, uint32_t nodes, uint32_t seed, double timeout) {
+    MacroResult result;
+    result.sim = sim;
+    result.nodes = nodes;
+    result.seed = seed;
+
+    char outPath[] = "/tmp/gossip_bench_XXXXXX";
+    int outFd = mkstemp(outPath);
+    NS_ABORT_MSG_IF(outFd < 0, "Could not create temporary output file");
+
+    std::string nodesArg = "--nodes=" + std::to_string(nodes);
+    std::string seedArg = "--seed=" + std::to_string(seed);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        // NS_LOG output goes to stderr; only the stdout summary is parsed
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(outFd, STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+        execl(binary.c_str(), binary.c_str(), nodesArg.c_str(), seedArg.c_str(), (char *)nullptr);
+        _exit(127);
+    }
+    close(outFd);
+
+    int status = 0;
+    struct rusage usage = {};
+    while (true) {
+        pid_t done = wait4(pid, &status, WNOHANG, &usage);
+        if (done == pid) break;
+        if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > timeout) {
+            kill(pid, SIGKILL);
+            wait4(pid, &status, 0, &usage);
+            result.timedOut = true;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.peakRssKb = usage.ru_maxrss;
+    result.exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+
+    // The gossip sims print a JSON summary with "events_executed" and
+    // "simulated_time" members, P2Pool_v2 prints plain lines
+    auto valueAfter = [](const std::string& line, const std::string& key) -> const char* {
+        size_t at = line.find(key);
+        return at == std::string::npos ? nullptr : line.c_str() + at + key.size();
+    };
+    std::ifstream output(outPath);
+    std::string line;
+    while (std::getline(output, line)) {
+        if (const char* value = valueAfter(line, "\"events_executed\": ")) {
+            result.events = std::strtoull(value, nullptr, 10);
+        } else if (const char* value = valueAfter(line, "\"simulated_time\": ")) {
+            result.simSeconds = std::strtod(value, nullptr);
+        } else if (line.rfind("Events executed: ", 0) == 0) {
+            result.events = std::stoull(line.substr(17));
+        } else if (line.rfind("Simulated time: ", 0) == 0) {
+            result.simSeconds = std::stod(line.substr(16));
+        }
+    }
+    unlink(outPath);
+    return result;
+}
+
+// Built binary of a simulation. Without a pattern the ns-3 build tree is searched,
+// which names binaries ns3-dev-<sim>-default in a git checkout and
+// ns3.<version>-<sim>-default in a release.
+static std::string FindBinary(const std::string& sim, const std::string& binPattern) {
+    std::string binary = binPattern;
+    if (binary.empty()) {
+        glob_t matches;
+        std::string pattern = "build/scratch/ns3*-" + sim + "-default";
+        if (glob(pattern.c_str(), 0, nullptr, &matches) == 0 && matches.gl_pathc > 0) {
+            binary = matches.gl_pathv[0];
+        }
+        globfree(&matches);
+        NS_ABORT_MSG_IF(binary.empty(), "No binary matching " << pattern << " for " << sim
+                        << "; run ./ns3 build from the ns-3 root or pass --binPattern");
+    } else {
+        size_t pos = binary.find("%s");
+        if (pos != std::string::npos) binary.replace(pos, 2, sim);
+    }
+    NS_ABORT_MSG_IF(access(binary.c_str(), X_OK) != 0, "Simulation binary " << binary << " not found or not executable");
+    return binary;
+}
+
+// ---------------------------------------------------------------------------
+// JSON output
+// ---------------------------------------------------------------------------
+
+static void WriteJson(std::ostream& os, const std::vector<MicroResult>& micro, const std::vector<MacroResult>& macro) {
+    os << "{\n  \"micro\": [";
+    for (size_t i = 0; i < micro.size(); i++) {
+        os << (i ? "," : "") << "\n    {\"name\": \"" << micro[i].name
+           << "\", \"iterations\": " << micro[i].iterations
+           << ", \"ns_per_op\": " << micro[i].nsPerOp << "}";
+    }
+    os << "\n  ],\n  \"macro\": [";
+    for (size_t i = 0; i < macro.size(); i++) {
+        const MacroResult& r = macro[i];
+        double eventsPerSec = r.wallSeconds > 0 ? r.events / r.wallSeconds : 0.0;
+        double simPerWall = r.wallSeconds > 0 ? r.simSeconds / r.wallSeconds : 0.0;
+        os << (i ? "," : "") << "\n    {\"sim\": \"" << r.sim
+           << "\", \"nodes\": " << r.nodes
+           << ", \"seed\": " << r.seed
+           << ", \"wall_seconds\": " << r.wallSeconds
+           << ", \"events\": " << r.events
+           << ", \"events_per_sec\": " << eventsPerSec
+           << ", \"peak_rss_kb\": " << r.peakRssKb
+           << ", \"sim_seconds\": " << r.simSeconds
+           << ", \"sim_seconds_per_wall_second\": " << simPerWall
+           << ", \"exit_status\": " << r.exitStatus
+           << ", \"timed_out\": " << (r.timedOut ? "true" : "false") << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+int main(int argc, char *argv[]) {
+    bool micro = true;
+    bool macro = true;
+    uint64_t iterations = 1000000;
+    uint32_t microNodes = 10000;
+    uint32_t microPeers = 8;
+    std::string sims = "ScheduleWithContext,Gossip_with_miners,P2Pool_v2";
+    std::string sizes = "1000,10000,100000";
+    uint32_t seed = 1;
+    std::string binPattern;
+    double timeout = 1800.0;
+    std::string out;
+
+    CommandLine cmd;
+    cmd.AddValue("micro", "Run the micro benchmarks", micro);
+    cmd.AddValue("macro", "Run the end-to-end simulations", macro);
+    cmd.AddValue("iterations", "Iterations per micro benchmark", iterations);
+    cmd.AddValue("microNodes", "Network size used by the naming, scheduling and topology micro benchmarks", microNodes);
+    cmd.AddValue("microPeers", "Peers per node used by the topology micro benchmark", microPeers);
+    cmd.AddValue("sims", "Comma separated simulations to run end-to-end", sims);
+    cmd.AddValue("sizes", "Comma separated node counts for the end-to-end runs", sizes);
+    cmd.AddValue("seed", "Seed passed to every end-to-end run", seed);
+    cmd.AddValue("binPattern", "Path of the simulation binaries, %s is replaced by the simulation name (default: search build/scratch)", binPattern);
+    cmd.AddValue("timeout", "Wall-clock limit per end-to-end run in seconds", timeout);
+    cmd.AddValue("out", "Write the JSON results to this file instead of stdout", out);
+    cmd.Parse(argc, argv);
+
+    srand(seed);
+
+    // The end-to-end runs go first: a forked child's peak RSS includes whatever
+    // the parent had resident at fork time, so fork while we are still small
+    std::vector<MacroResult> macroResults;
+    if (macro) {
+        for (const auto& sim : Split(sims, ',')) {
+            std::string binary = FindBinary(sim, binPattern);
+
+            for (const auto& size : Split(sizes, ',')) {
+                uint32_t nodes = std::stoul(size);
+                std::cerr << "Running " << sim << " with " << nodes << " nodes..." << std::endl;
+                macroResults.push_back(RunMacro(binary, sim, nodes, seed, timeout));
+            }
+        }
+    }
+
+    std::vector<MicroResult> microResults;
+    if (micro) {
+        microResults = RunMicro(iterations, microNodes, microPeers);
+    }
+
+    if (out.empty()) {
+        WriteJson(std::cout, microResults, macroResults);
+    } else {
+        std::ofstream file(out);
+        WriteJson(file, microResults, macroResults);
+    }
+    return 0;
+}
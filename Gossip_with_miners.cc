@@ -4,115 +4,649 @@
 #include "ns3/applications-module.h"
 #include "ns3/wifi-module.h"
 #include "ns3/mobility-module.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <set>
+#include <unistd.h>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "gossip/hot-path.h"
+#include "gossip/stats.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("TcpGossip");
 
+// Keeps track of which nodes are currently online. Nodes coming back after churn
+// (and nodes replacing a dead peer) ask it for fresh neighbors.
+class BootstrapServer {
+private:
+    static std::vector<Ipv4Address> s_online;
+    static std::map<Ipv4Address, uint32_t> s_index;
+
+public:
+    static void Register(Ipv4Address addr) {
+        if (s_index.count(addr) > 0) return;
+        s_index[addr] = s_online.size();
+        s_online.push_back(addr);
+    }
+
+    static void Unregister(Ipv4Address addr) {
+        auto it = s_index.find(addr);
+        if (it == s_index.end()) return;
+
+        uint32_t idx = it->second;
+        s_online[idx] = s_online.back();
+        s_index[s_online[idx]] = idx;
+        s_online.pop_back();
+        s_index.erase(addr);
+    }
+
+    static bool IsOnline(Ipv4Address addr) {
+        return s_index.count(addr) > 0;
+    }
+
+    static uint32_t OnlineCount() {
+        return s_online.size();
+    }
+
+    // Up to `count` random online nodes, excluding `self` and anything in `exclude`
+    static std::vector<Ipv4Address> Sample(uint32_t count, Ipv4Address self, const std::vector<Ipv4Address>& exclude) {
+        std::vector<Ipv4Address> picked;
+        uint32_t attempts = 0;
+        while (picked.size() < count && !s_online.empty() && attempts++ < 20 * count) {
+            Ipv4Address candidate = s_online[rand() % s_online.size()];
+            if (candidate == self) continue;
+            if (std::find(exclude.begin(), exclude.end(), candidate) != exclude.end()) continue;
+            if (std::find(picked.begin(), picked.end(), candidate) != picked.end()) continue;
+            picked.push_back(candidate);
+        }
+        return picked;
+    }
+};
+
+std::vector<Ipv4Address> BootstrapServer::s_online;
+std::map<Ipv4Address, uint32_t> BootstrapServer::s_index;
+
+// Coverage and latency of every mined share, updated as shares arrive
+class PropagationStats {
+public:
+    struct ShareRecord {
+        double minedAt = 0.0;
+        uint32_t origin = 0;
+        uint32_t liveReceivers = 0;     // reached through gossip, origin included
+        uint32_t catchUpReceivers = 0;  // reached through catch-up sync after a rejoin
+        double lastReceiveAt = 0.0;
+        double time90 = -1.0;           // time to reach 90% / all nodes through gossip, -1 if never
+        double time100 = -1.0;
+    };
+
+    static ShareIds shareIds;   // every share name on the network, gossip state refers to shares by id
+    static std::unordered_map<uint32_t, ShareRecord> shares;
+    static Histogram latency;
+    static uint32_t networkSize;
+
+    // Returns the id the share is gossiped under
+    static uint32_t OnMined(const std::string& msg, uint32_t origin) {
+        uint32_t share = shareIds.Intern(msg);
+        ShareRecord& record = shares[share];
+        record.minedAt = Simulator::Now().GetSeconds();
+        record.origin = origin;
+        record.liveReceivers = 1;
+        record.lastReceiveAt = record.minedAt;
+        return share;
+    }
+
+    static void OnReceived(uint32_t share, bool catchUp) {
+        auto it = shares.find(share);
+        if (it == shares.end()) return;
+
+        ShareRecord& record = it->second;
+        if (catchUp) {
+            record.catchUpReceivers++;
+            return;
+        }
+        double now = Simulator::Now().GetSeconds();
+        record.liveReceivers++;
+        record.lastReceiveAt = now;
+        if (record.time90 < 0 && 10 * record.liveReceivers >= 9 * networkSize) record.time90 = now - record.minedAt;
+        if (record.time100 < 0 && record.liveReceivers >= networkSize) record.time100 = now - record.minedAt;
+        latency.Add(now - record.minedAt);
+    }
+
+    // Aggregate coverage plus the `topK` slowest shares
+    static void WriteJson(std::ostream& os, uint32_t topK) {
+        double liveCoverage = 0.0;
+        double totalCoverage = 0.0;
+        uint32_t fullyCovered = 0;
+        double time90Sum = 0.0, time100Sum = 0.0;
+        uint32_t reached90 = 0, reached100 = 0;
+
+        SlowestShares slowest(topK);
+
+        for (const auto& [share, record] : shares) {
+            liveCoverage += static_cast<double>(record.liveReceivers) / networkSize;
+            totalCoverage += static_cast<double>(record.liveReceivers + record.catchUpReceivers) / networkSize;
+            if (record.liveReceivers + record.catchUpReceivers == networkSize) fullyCovered++;
+            if (record.time90 >= 0) { time90Sum += record.time90; reached90++; }
+            if (record.time100 >= 0) { time100Sum += record.time100; reached100++; }
+
+            bool full = record.time100 >= 0;
+            slowest.Offer(full, full ? record.time100 : record.lastReceiveAt - record.minedAt, shareIds.Name(share), share);
+        }
+        std::vector<SlowestShares::Entry> top = slowest.Take();
+
+        size_t count = std::max<size_t>(shares.size(), 1);
+        os << "{\"shares\": " << shares.size()
+           << ", \"mean_coverage_gossip\": " << liveCoverage / count
+           << ", \"mean_coverage_with_catch_up\": " << totalCoverage / count
+           << ", \"fully_covered\": " << fullyCovered
+           << ", \"mean_time_to_90\": " << (reached90 ? time90Sum / reached90 : 0.0)
+           << ", \"mean_time_to_100\": " << (reached100 ? time100Sum / reached100 : 0.0)
+           << ",\n    \"latency\": ";
+        latency.WriteJson(os);
+        os << ",\n    \"slowest\": [";
+        for (size_t i = 0; i < top.size(); i++) {
+            const ShareRecord& record = shares[top[i].id];
+            os << (i ? "," : "") << "\n      {\"share\": \"" << top[i].name << "\", \"origin\": " << record.origin
+               << ", \"receivers\": " << record.liveReceivers << ", \"complete\": " << (top[i].complete ? "true" : "false")
+               << ", \"time\": " << top[i].time << "}";
+        }
+        os << (top.empty() ? "]}" : "\n    ]}");
+    }
+};
+
+ShareIds PropagationStats::shareIds;
+std::unordered_map<uint32_t, PropagationStats::ShareRecord> PropagationStats::shares;
+Histogram PropagationStats::latency(0.01, 6000);
+uint32_t PropagationStats::networkSize = 0;
+
+// Hot-path counters, one slot per node. A node only ever touches its own slot, so
+// no locking is needed; totals are summed on demand by the reporter. Slots are
+// cache-line aligned so neighbouring nodes never share a line.
+struct alignas(64) NodeCounters {
+    uint64_t socketsCreated = 0;
+    uint64_t socketsClosed = 0;
+    uint64_t handshakes = 0;         // connections established, outgoing and accepted
+    uint64_t packetsSent = 0;
+    uint64_t packetsReceived = 0;
+    uint64_t duplicateReceives = 0;
+    uint64_t appEventsScheduled = 0;  // by the gossip and miner apps; TCP, Wi-Fi and ARP events are not counted
+    uint64_t messageBytes = 0;       // bytes allocated for outgoing and incoming messages
+    uint64_t retransmits = 0;        // datagram transport only
+    uint64_t fecRecovered = 0;
+    uint64_t datagramsAbandoned = 0; // retransmissions exhausted
+
+    void Add(const NodeCounters& other) {
+        socketsCreated += other.socketsCreated;
+        socketsClosed += other.socketsClosed;
+        handshakes += other.handshakes;
+        packetsSent += other.packetsSent;
+        packetsReceived += other.packetsReceived;
+        duplicateReceives += other.duplicateReceives;
+        appEventsScheduled += other.appEventsScheduled;
+        messageBytes += other.messageBytes;
+        retransmits += other.retransmits;
+        fecRecovered += other.fecRecovered;
+        datagramsAbandoned += other.datagramsAbandoned;
+    }
+};
+
+class Instrumentation {
+public:
+    static std::vector<NodeCounters> perNode;
+    static uint64_t wifiFramesTx;
+    static uint64_t wifiRxDrops;
+
+    static void Init(uint32_t numNodes) {
+        perNode.assign(numNodes, NodeCounters());
+        Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/PhyTxBegin",
+                                      MakeCallback(&Instrumentation::OnPhyTxBegin));
+        Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/PhyRxDrop",
+                                      MakeCallback(&Instrumentation::OnPhyRxDrop));
+    }
+
+    static NodeCounters& For(uint32_t nodeId) {
+        return perNode[nodeId];
+    }
+
+    static NodeCounters Total() {
+        NodeCounters total;
+        for (const auto& counters : perNode) {
+            total.Add(counters);
+        }
+        return total;
+    }
+
+    // Resident set size of this process in MB
+    static double LiveMemoryMb() {
+        std::ifstream statm("/proc/self/statm");
+        uint64_t size = 0;
+        uint64_t resident = 0;
+        statm >> size >> resident;
+        return resident * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+    }
+
+    static void WriteJson(std::ostream& os) {
+        NodeCounters total = Total();
+        os << "{\"sockets_created\": " << total.socketsCreated
+           << ", \"sockets_open\": " << total.socketsCreated - total.socketsClosed
+           << ", \"handshakes\": " << total.handshakes
+           << ", \"packets_sent\": " << total.packetsSent
+           << ", \"packets_received\": " << total.packetsReceived
+           << ", \"duplicate_receives\": " << total.duplicateReceives
+           << ", \"app_events_scheduled\": " << total.appEventsScheduled
+           << ", \"message_bytes\": " << total.messageBytes
+           << ", \"retransmits\": " << total.retransmits
+           << ", \"fec_recovered\": " << total.fecRecovered
+           << ", \"datagrams_abandoned\": " << total.datagramsAbandoned
+           << ", \"wifi_frames_tx\": " << wifiFramesTx
+           << ", \"wifi_rx_drops\": " << wifiRxDrops
+           << ", \"rss_mb\": " << LiveMemoryMb() << "}";
+    }
+
+private:
+    static void OnPhyTxBegin(Ptr<const Packet> packet, double txPowerW) {
+        wifiFramesTx++;
+    }
+
+    static void OnPhyRxDrop(Ptr<const Packet> packet, WifiPhyRxfailureReason reason) {
+        wifiRxDrops++;
+    }
+};
+
+std::vector<NodeCounters> Instrumentation::perNode;
+uint64_t Instrumentation::wifiFramesTx = 0;
+uint64_t Instrumentation::wifiRxDrops = 0;
+
+// Prints simulated time, wall time, event rate and memory every `interval` of
+// simulated time, so a slow run shows where it is and how fast it is going
+class ProgressReporter {
+private:
+    Time m_interval;
+    std::chrono::steady_clock::time_point m_wallStart;
+    std::chrono::steady_clock::time_point m_lastWall;
+    uint64_t m_lastEvents = 0;
+
+public:
+    void Start(Time interval) {
+        m_interval = interval;
+        m_wallStart = std::chrono::steady_clock::now();
+        m_lastWall = m_wallStart;
+        Simulator::Schedule(m_interval, &ProgressReporter::Report, this);
+    }
+
+private:
+    void Report() {
+        auto now = std::chrono::steady_clock::now();
+        uint64_t events = Simulator::GetEventCount();
+        double wall = std::chrono::duration<double>(now - m_wallStart).count();
+        double sinceLast = std::chrono::duration<double>(now - m_lastWall).count();
+        double rate = sinceLast > 0 ? (events - m_lastEvents) / sinceLast : 0.0;
+        NodeCounters total = Instrumentation::Total();
+
+        std::cerr << "[progress] sim " << Simulator::Now().GetSeconds() << "s"
+                  << ", wall " << wall << "s"
+                  << ", " << static_cast<uint64_t>(rate) << " events/s"
+                  << ", rss " << Instrumentation::LiveMemoryMb() << " MB"
+                  << ", open sockets " << total.socketsCreated - total.socketsClosed
+                  << ", packets " << total.packetsSent << std::endl;
+
+        m_lastWall = now;
+        m_lastEvents = events;
+        Simulator::Schedule(m_interval, &ProgressReporter::Report, this);
+    }
+};
+
+// Framing of the datagram transport. DATA carries newline-terminated gossip
+// frames, ACK acknowledges one DATA sequence number and PARITY is the XOR of a
+// group of DATA payloads, so one loss per group is repaired without waiting
+// for a retransmission.
+class GossipDatagramHeader : public Header {
+public:
+    enum Type : uint8_t { DATA = 0, ACK = 1, PARITY = 2 };
+
+    uint8_t type = DATA;
+    uint32_t seq = 0;        // per sender/receiver pair; first seq of the group for PARITY
+    uint32_t fecGroup = 0;
+    uint8_t fecIndex = 0;
+    uint8_t fecSize = 0;     // 0 if not FEC protected (acks, retransmissions)
+
+    static TypeId GetTypeId() {
+        static TypeId tid = TypeId("GossipDatagramHeader")
+            .SetParent<Header>()
+            .SetGroupName("Applications")
+            .AddConstructor<GossipDatagramHeader>();
+        return tid;
+    }
+
+    TypeId GetInstanceTypeId() const override { return GetTypeId(); }
+
+    uint32_t GetSerializedSize() const override { return 11; }
+
+    void Serialize(Buffer::Iterator start) const override {
+        start.WriteU8(type);
+        start.WriteHtonU32(seq);
+        start.WriteHtonU32(fecGroup);
+        start.WriteU8(fecIndex);
+        start.WriteU8(fecSize);
+    }
+
+    uint32_t Deserialize(Buffer::Iterator start) override {
+        type = start.ReadU8();
+        seq = start.ReadNtohU32();
+        fecGroup = start.ReadNtohU32();
+        fecIndex = start.ReadU8();
+        fecSize = start.ReadU8();
+        return GetSerializedSize();
+    }
+
+    void Print(std::ostream& os) const override {
+        os << "type=" << static_cast<uint32_t>(type) << " seq=" << seq
+           << " group=" << fecGroup << " index=" << static_cast<uint32_t>(fecIndex)
+           << " size=" << static_cast<uint32_t>(fecSize);
+    }
+};
+
+NS_OBJECT_ENSURE_REGISTERED(GossipDatagramHeader);
+
 class TcpGossipApp : public Application {
 private:
+    // Liveness bookkeeping for one neighbor. There is a single probe timer per
+    // neighbor, never one per message.
+    struct PeerState {
+        double lastSeen = 0.0;
+        uint32_t failures = 0;
+        bool probing = false;
+        EventId probeEvent;
+    };
+
     Ptr<Socket> m_socket;
     std::vector<Ipv4Address> m_neighbors;
+    std::map<Ipv4Address, PeerState> m_peerState;
 
     std::unordered_map<Ptr<Socket>, std::string> pendingMessages;
     std::unordered_map<Ptr<Socket>, Ipv4Address> socketToAddress;
     std::unordered_set<Ptr<Socket>> m_connectedSockets;
+    std::unordered_map<Ptr<Socket>, std::string> m_rxBuffers;
 
-    std::unordered_set<std::string> receivedMessages;
-    std::unordered_set<std::string> forwardedMessages;
+    SeenShares m_received;
+    std::vector<std::pair<double, uint32_t>> m_receiveLog;  // (time first seen, share), in that order
+    SeenShares m_forwarded;
 
     Ipv4Address m_myAddress;
     uint32_t m_nodeId;
     bool m_isSender;
 
+    bool m_online = false;
+    double m_offlineSince = 0.0;
+    uint32_t m_targetDegree = 0;
+    bool m_liveness = false;
+    Time m_probeInterval = Seconds(5.0);
+    uint32_t m_deadThreshold = 2;
+    uint32_t m_catchUpReceived = 0;
+
+    // Datagram transport (--transport=udp): one socket per node, per-peer
+    // sequence numbers, acks with exponential-backoff retransmission and
+    // optional XOR parity over groups of `m_fecGroupSize` datagrams
+    struct UnackedDatagram {
+        std::string payload;
+        double deadline = 0.0;
+        uint32_t retries = 0;
+    };
+
+    struct UdpTxState {
+        uint32_t nextSeq = 0;
+        std::map<uint32_t, UnackedDatagram> unacked;
+        EventId retransmitEvent;
+        uint32_t fecGroup = 0;
+        uint32_t fecFirstSeq = 0;
+        std::vector<std::string> fecBlocks;   // length-prefixed payloads of the open group
+        EventId fecFlushEvent;
+    };
+
+    struct FecGroup {
+        uint32_t firstSeq = 0;
+        std::map<uint8_t, std::string> blocks;
+        std::string parity;
+        uint8_t size = 0;                     // known once the parity has arrived
+    };
+
+    struct UdpRxState {
+        uint32_t nextExpected = 0;            // everything below has been delivered
+        std::set<uint32_t> ahead;             // delivered out of order
+        std::map<uint32_t, FecGroup> fecGroups;
+    };
+
+    static const size_t kMaxDatagramPayload = 1200;
+    static const size_t kRxWindow = 1024;
+    static const size_t kFecGroupsKept = 32;
+
+    bool m_udp = false;
+    Time m_udpRto = MilliSeconds(50);
+    uint32_t m_udpMaxRetries = 4;
+    uint32_t m_fecGroupSize = 0;
+    std::map<Ipv4Address, UdpTxState> m_udpTx;
+    std::map<Ipv4Address, UdpRxState> m_udpRx;
+
 public:
+    static uint32_t deadPeersDetected;
+
     TcpGossipApp(Ipv4Address myAddress) : m_myAddress(myAddress), m_isSender(false) {}
 
     void AddNeighbor(Ipv4Address neighbor) {
         if (neighbor != m_myAddress) {
             m_neighbors.push_back(neighbor);
+            m_peerState[neighbor];
         }
     }
 
-    void PrintNeighbors() const {
-        std::cout << "Neighbors of " << m_myAddress << ":" << std::endl;
-        for (const auto& neighbor : m_neighbors) {
-            std::cout << neighbor << std::endl;
-        }
+    // Turns on dead-peer detection (only used with churn). A neighbor is dropped
+    // after `deadThreshold` consecutive failed connections, and probed only if it
+    // has been silent for a whole `probeInterval`
+    void SetLivenessParams(Time probeInterval, uint32_t deadThreshold) {
+        m_liveness = true;
+        m_probeInterval = probeInterval;
+        m_deadThreshold = deadThreshold;
+    }
+
+    // Gossip over UDP instead of a TCP connection per message. A datagram is
+    // retransmitted after `rto` (doubling each time) up to `maxRetries` times;
+    // running out counts as a failed connection for dead-peer detection.
+    // `fecGroupSize` > 0 adds one parity datagram per that many datagrams.
+    void SetDatagramTransport(Time rto, uint32_t maxRetries, uint32_t fecGroupSize) {
+        m_udp = true;
+        m_udpRto = rto;
+        m_udpMaxRetries = maxRetries;
+        m_fecGroupSize = fecGroupSize;
     }
     
     void StartApplication() override {
         m_nodeId = GetNode()->GetId();
-        PrintNeighbors();
-        m_socket = Socket::CreateSocket(GetNode(), TcpSocketFactory::GetTypeId());
-        m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), 8080));
-        m_socket->Listen();
+        m_targetDegree = m_neighbors.size();
+        OpenListeningSocket();
 
-        m_socket->SetAcceptCallback(
-            MakeCallback(&TcpGossipApp::AcceptConnection, this),
-            MakeCallback(&TcpGossipApp::HandleAccept, this)
-        );
-        m_socket->SetRecvCallback(MakeCallback(&TcpGossipApp::ReceiveMessage, this));
+        m_online = true;
+        BootstrapServer::Register(m_myAddress);
+        for (const auto& neighbor : m_neighbors) {
+            ArmProbe(neighbor);
+        }
+    }
+
+    // Node crashes: the Wi-Fi interface goes down and all connections are dropped
+    void GoOffline() {
+        if (!m_online) return;
+
+        m_online = false;
+        m_offlineSince = Simulator::Now().GetSeconds();
+        BootstrapServer::Unregister(m_myAddress);
+        SetInterfaceUp(false);
+
+        for (auto& entry : m_peerState) {
+            Simulator::Cancel(entry.second.probeEvent);
+            entry.second.probing = false;
+        }
+
+        m_socket->Close();
+        m_socket = nullptr;
+        for (const auto& socket : m_connectedSockets) {
+            socket->Close();
+        }
+        for (const auto& entry : socketToAddress) {
+            entry.first->Close();
+        }
+        Counters().socketsClosed += 1 + m_connectedSockets.size() + socketToAddress.size();
+        m_connectedSockets.clear();
+        pendingMessages.clear();
+        socketToAddress.clear();
+        m_rxBuffers.clear();
+
+        // Sequence numbers survive so peers don't mistake new datagrams for old ones
+        for (auto& entry : m_udpTx) {
+            ResetDatagramsTo(entry.second);
+        }
+        for (auto& entry : m_udpRx) {
+            entry.second.fecGroups.clear();
+        }
+
+        NS_LOG_INFO("Node " << m_nodeId << " went offline");
+    }
+
+    // Node comes back: rebuild the neighbor set from the bootstrap server and ask
+    // the neighbors for everything that was gossiped while we were away
+    void GoOnline() {
+        if (m_online) return;
+
+        SetInterfaceUp(true);
+        OpenListeningSocket();
+        m_online = true;
+        BootstrapServer::Register(m_myAddress);
+
+        RefreshNeighbors();
+        for (const auto& neighbor : m_neighbors) {
+            m_peerState[neighbor].lastSeen = Simulator::Now().GetSeconds();
+            ArmProbe(neighbor);
+        }
+
+        // Shares that were still in flight when we left are requested too
+        std::string request = "SYNC " + std::to_string(m_offlineSince - 1.0);
+        for (const auto& neighbor : m_neighbors) {
+            SendToPeer(neighbor, request);
+        }
+
+        NS_LOG_INFO("Node " << m_nodeId << " back online with " << m_neighbors.size() << " neighbors");
     }
 
+    bool IsOnline() const { return m_online; }
+
+    uint32_t GetCatchUpReceived() const { return m_catchUpReceived; }
+
     bool AcceptConnection(Ptr<Socket> socket, const Address &from) {
         return true;
     }
 
     void HandleAccept(Ptr<Socket> socket, const Address &from) {
+        Counters().socketsCreated++;
+        Counters().handshakes++;
         m_connectedSockets.insert(socket);
         socket->SetRecvCallback(MakeCallback(&TcpGossipApp::ReceiveMessage, this));
     }
 
-    void SendMessage(std::string msg) {
-        if (receivedMessages.count(msg) > 0) return;
+    void SendMessage(uint32_t share) {
+        if (!m_received.Insert(share)) return;
 
-        receivedMessages.insert(msg);
-        ForwardMessage(msg);
+        m_receiveLog.emplace_back(Simulator::Now().GetSeconds(), share);
+        ForwardMessage(share);
     }
 
+    // Messages are newline-terminated so several of them (e.g. a catch-up reply)
+    // can share one connection and survive TCP segmentation
     void ReceiveMessage(Ptr<Socket> socket) {
+        if (!m_online) return;
+
         Address from;
         socket->GetPeerName(from);
         Ipv4Address senderAddress = InetSocketAddress::ConvertFrom(from).GetIpv4();
-    
-        Ptr<Packet> packet = socket->Recv();
-        if (!packet || packet->GetSize() == 0) return;
-    
-        uint32_t size = packet->GetSize();
-        std::vector<uint8_t> buffer(size);  
-        packet->CopyData(buffer.data(), size);
-        std::string msg(buffer.begin(), buffer.end());
-    
-        uint32_t senderNodeId = ExtractNodeIdFromIpv4(senderAddress);
-    
-        // NS_LOG_INFO("Node " << m_nodeId << " received message \"" << msg 
-        //             << "\" from Node " << senderNodeId << " (" << senderAddress << ")");
-    
-        if (receivedMessages.count(msg) == 0) {
-            receivedMessages.insert(msg);
-            Simulator::Schedule(MilliSeconds(10 + rand() % 20), &TcpGossipApp::ForwardMessage, this, msg);
+        MarkAlive(senderAddress);
+
+        std::string& buffer = m_rxBuffers[socket];
+        Ptr<Packet> packet;
+        while ((packet = socket->Recv()) && packet->GetSize() > 0) {
+            Counters().packetsReceived++;
+            Counters().messageBytes += AppendPayload(buffer, packet);
+        }
+
+        std::vector<std::string> frames = TakeFrames(buffer);
+        if (buffer.empty()) {
+            m_rxBuffers.erase(socket);
+        }
+
+        for (const auto& frame : frames) {
+            HandleFrame(socket, senderAddress, frame);
+        }
+    }
+
+    void ReceiveDatagram(Ptr<Socket> socket) {
+        Address from;
+        Ptr<Packet> packet;
+        while (m_online && (packet = socket->RecvFrom(from))) {
+            Ipv4Address sender = InetSocketAddress::ConvertFrom(from).GetIpv4();
+            GossipDatagramHeader header;
+            packet->RemoveHeader(header);
+            uint32_t size = packet->GetSize();
+            std::string payload(size, '\0');
+            packet->CopyData(reinterpret_cast<uint8_t *>(&payload[0]), size);
+            Counters().packetsReceived++;
+            Counters().messageBytes += size;
+            MarkAlive(sender);
+
+            switch (header.type) {
+            case GossipDatagramHeader::ACK: {
+                auto tx = m_udpTx.find(sender);
+                if (tx != m_udpTx.end()) {
+                    tx->second.unacked.erase(header.seq);
+                }
+                break;
+            }
+            case GossipDatagramHeader::DATA:
+                SendAck(sender, header.seq);
+                if (header.fecSize > 0) {
+                    FecGroup& group = FecGroupFor(sender, header.fecGroup);
+                    group.firstSeq = header.seq - header.fecIndex;
+                    group.blocks[header.fecIndex] = FecBlock(payload);
+                }
+                DeliverDatagram(sender, header.seq, payload);
+                if (header.fecSize > 0) {
+                    TryFecRecovery(sender, header.fecGroup);
+                }
+                break;
+            case GossipDatagramHeader::PARITY: {
+                FecGroup& group = FecGroupFor(sender, header.fecGroup);
+                group.firstSeq = header.seq;
+                group.size = header.fecSize;
+                group.parity = payload;
+                TryFecRecovery(sender, header.fecGroup);
+                break;
+            }
+            }
         }
     }
     
 
-    void ForwardMessage(std::string msg) {
-        if (forwardedMessages.count(msg) > 0) return;
+    void ForwardMessage(uint32_t share) {
+        if (!m_online) return;
+        if (!m_forwarded.Insert(share)) return;
 
-        forwardedMessages.insert(msg);
-        NS_LOG_INFO("Nodef " << m_nodeId << " received message \"" << msg);
+        std::string msg(PropagationStats::shareIds.Name(share));
+        NS_LOG_INFO("Node " << m_nodeId << " forwarding \"" << msg << "\"");
         
         for (const auto &neighbor : m_neighbors) {
-            Ptr<Socket> sendSocket = Socket::CreateSocket(GetNode(), TcpSocketFactory::GetTypeId());
-            sendSocket->SetConnectCallback(
-                MakeCallback(&TcpGossipApp::HandleConnected, this),
-                MakeNullCallback<void, Ptr<Socket>>()
-            );
-            sendSocket->Connect(InetSocketAddress(neighbor, 8080));
-            pendingMessages[sendSocket] = msg;
-            socketToAddress[sendSocket] = neighbor;
+            SendToPeer(neighbor, msg);
         }
     }
 
@@ -123,49 +657,481 @@ public:
 
             Ptr<Packet> packet = Create<Packet>((uint8_t *)msg.c_str(), msg.size());
             socket->Send(packet);
+            socket->SetRecvCallback(MakeCallback(&TcpGossipApp::ReceiveMessage, this));
+            Counters().handshakes++;
+            Counters().packetsSent++;
+            Counters().messageBytes += msg.size();
 
-            Simulator::Schedule(Seconds(30.0), &TcpGossipApp::CloseSocket, this, socket);
+            Schedule(Seconds(30.0), &TcpGossipApp::CloseSocket, this, socket);
             pendingMessages.erase(it);
+
+            auto peer = socketToAddress.find(socket);
+            if (peer != socketToAddress.end()) {
+                MarkAlive(peer->second);
+            }
         }
     }
 
+    void HandleConnectFailed(Ptr<Socket> socket) {
+        auto it = socketToAddress.find(socket);
+        if (it == socketToAddress.end()) return;
+
+        Ipv4Address peer = it->second;
+        pendingMessages.erase(socket);
+        socketToAddress.erase(it);
+        Counters().socketsClosed++;
+        MarkFailed(peer);
+    }
+
     void CloseSocket(Ptr<Socket> socket) {
+        // Already closed if the node went offline in the meantime
+        if (socketToAddress.erase(socket) == 0) return;
         socket->Close();
-        socketToAddress.erase(socket);
+        Counters().socketsClosed++;
+        m_rxBuffers.erase(socket);
     }
 
     void SetSender() { m_isSender = true; }
 
-    const std::unordered_set<std::string>& GetReceivedMessages() const {
-        return receivedMessages;
+    // One CSV row of per-node detail: node,address,online,received,catch_up,mined,neighbors
+    void WriteDetail(std::ostream& os, uint32_t minedBlocks) const {
+        os << m_nodeId << "," << m_myAddress << "," << m_online << "," << m_received.Size()
+           << "," << m_catchUpReceived << "," << minedBlocks << ",";
+        for (size_t i = 0; i < m_neighbors.size(); i++) {
+            os << (i ? ";" : "") << m_neighbors[i];
+        }
+    }
+
+private:
+    NodeCounters& Counters() {
+        return Instrumentation::For(m_nodeId);
+    }
+
+    template <typename... Args>
+    EventId Schedule(Time delay, Args&&... args) {
+        Counters().appEventsScheduled++;
+        return Simulator::Schedule(delay, std::forward<Args>(args)...);
     }
 
-    void PrintReceivedMessages() const {
-        std::cout << "Node " << m_nodeId << " received messages:\n";
-        for (const auto& msg : receivedMessages) {
-            std::cout << "  - " << msg << "\n";
+    void OpenListeningSocket() {
+        if (m_udp) {
+            m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+            Counters().socketsCreated++;
+            m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), 8080));
+            m_socket->SetRecvCallback(MakeCallback(&TcpGossipApp::ReceiveDatagram, this));
+            return;
         }
+
+        m_socket = Socket::CreateSocket(GetNode(), TcpSocketFactory::GetTypeId());
+        Counters().socketsCreated++;
+        m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), 8080));
+        m_socket->Listen();
+
+        m_socket->SetAcceptCallback(
+            MakeCallback(&TcpGossipApp::AcceptConnection, this),
+            MakeCallback(&TcpGossipApp::HandleAccept, this)
+        );
+        m_socket->SetRecvCallback(MakeCallback(&TcpGossipApp::ReceiveMessage, this));
     }
 
-private:
-    uint32_t ExtractNodeIdFromIpv4(Ipv4Address addr) {
-        std::stringstream ss;
-        ss << addr;
-        std::string ipStr = ss.str();
+    void SetInterfaceUp(bool up) {
+        // Interface 0 is loopback, 1 is the Wi-Fi device
+        Ptr<Ipv4> ipv4 = GetNode()->GetObject<Ipv4>();
+        if (up) {
+            ipv4->SetUp(1);
+        } else {
+            ipv4->SetDown(1);
+        }
+    }
+
+    void SendToPeer(Ipv4Address neighbor, const std::string& msg) {
+        if (m_udp) {
+            SendDatagrams(neighbor, msg + "\n");
+            return;
+        }
+
+        Ptr<Socket> sendSocket = Socket::CreateSocket(GetNode(), TcpSocketFactory::GetTypeId());
+        Counters().socketsCreated++;
+        sendSocket->SetConnectCallback(
+            MakeCallback(&TcpGossipApp::HandleConnected, this),
+            MakeCallback(&TcpGossipApp::HandleConnectFailed, this)
+        );
+        sendSocket->Connect(InetSocketAddress(neighbor, 8080));
+        pendingMessages[sendSocket] = msg + "\n";
+        socketToAddress[sendSocket] = neighbor;
+    }
+
+    // `socket` is the TCP connection the frame came in on, null for datagrams
+    void HandleFrame(Ptr<Socket> socket, Ipv4Address from, const std::string& frame) {
+        if (frame.empty() || frame == "PING") return;
+
+        if (frame.rfind("SYNC ", 0) == 0) {
+            HandleSyncRequest(socket, from, std::stod(frame.substr(5)));
+            return;
+        }
+
+        if (frame.rfind("CATCHUP ", 0) == 0) {
+            uint32_t share = PropagationStats::shareIds.Intern(std::string_view(frame).substr(8));
+            if (RecordReceive(share, true)) {
+                // Old news by now, the rest of the network already has it
+                m_forwarded.Insert(share);
+            } else {
+                Counters().duplicateReceives++;
+            }
+            return;
+        }
+
+        uint32_t share = PropagationStats::shareIds.Intern(frame);
+        if (RecordReceive(share, false)) {
+            Schedule(MilliSeconds(10 + rand() % 20), &TcpGossipApp::ForwardMessage, this, share);
+        } else {
+            Counters().duplicateReceives++;
+        }
+    }
+
+    // Replies on the requester's own connection with every share seen since `since`
+    void HandleSyncRequest(Ptr<Socket> socket, Ipv4Address from, double since) {
+        std::string reply;
+        auto first = std::lower_bound(m_receiveLog.begin(), m_receiveLog.end(), std::make_pair(since, uint32_t(0)));
+        for (auto it = first; it != m_receiveLog.end(); ++it) {
+            reply += "CATCHUP ";
+            reply += PropagationStats::shareIds.Name(it->second);
+            reply += "\n";
+        }
+        if (reply.empty()) return;
+
+        if (!socket) {
+            SendDatagrams(from, reply);
+            return;
+        }
+
+        Ptr<Packet> packet = Create<Packet>((uint8_t *)reply.c_str(), reply.size());
+        socket->Send(packet);
+        Counters().packetsSent++;
+        Counters().messageBytes += reply.size();
+    }
 
-        size_t lastDot = ipStr.find_last_of('.');
-        if (lastDot != std::string::npos && lastDot + 1 < ipStr.length()) {
-            return std::stoi(ipStr.substr(lastDot + 1));
+    // False if the share had been seen before
+    bool RecordReceive(uint32_t share, bool catchUp) {
+        if (!m_received.Insert(share)) return false;
+
+        m_receiveLog.emplace_back(Simulator::Now().GetSeconds(), share);
+        PropagationStats::OnReceived(share, catchUp);
+        if (catchUp) {
+            m_catchUpReceived++;
+        }
+        return true;
+    }
+
+    // Cuts `data` at frame boundaries into datagrams that fit one Wi-Fi frame.
+    // A single frame longer than that is sent whole and left to IP fragmentation.
+    void SendDatagrams(Ipv4Address peer, const std::string& data) {
+        size_t start = 0;
+        while (start < data.size()) {
+            size_t end = data.size();
+            if (end - start > kMaxDatagramPayload) {
+                size_t cut = data.rfind('\n', start + kMaxDatagramPayload - 1);
+                if (cut == std::string::npos || cut < start) {
+                    cut = data.find('\n', start);
+                }
+                end = cut == std::string::npos ? data.size() : cut + 1;
+            }
+            SendReliable(peer, data.substr(start, end - start));
+            start = end;
+        }
+    }
+
+    void SendReliable(Ipv4Address peer, const std::string& payload) {
+        UdpTxState& tx = m_udpTx[peer];
+        GossipDatagramHeader header;
+        header.type = GossipDatagramHeader::DATA;
+        header.seq = tx.nextSeq++;
+
+        if (m_fecGroupSize > 0) {
+            if (tx.fecBlocks.empty()) {
+                tx.fecFirstSeq = header.seq;
+                // Parity for a partial group goes out before the first retransmission would
+                tx.fecFlushEvent = Schedule(Seconds(m_udpRto.GetSeconds() / 2), &TcpGossipApp::FlushFecGroup, this, peer);
+            }
+            header.fecGroup = tx.fecGroup;
+            header.fecIndex = tx.fecBlocks.size();
+            header.fecSize = m_fecGroupSize;
+            tx.fecBlocks.push_back(FecBlock(payload));
+        }
+
+        SendDatagram(peer, header, payload);
+
+        UnackedDatagram& pending = tx.unacked[header.seq];
+        pending.payload = payload;
+        pending.deadline = Simulator::Now().GetSeconds() + m_udpRto.GetSeconds();
+        if (tx.unacked.size() == 1) {
+            Simulator::Cancel(tx.retransmitEvent);
+            tx.retransmitEvent = Schedule(m_udpRto, &TcpGossipApp::RetransmitExpired, this, peer);
+        }
+
+        if (m_fecGroupSize > 0 && tx.fecBlocks.size() == m_fecGroupSize) {
+            FlushFecGroup(peer);
+        }
+    }
+
+    void SendDatagram(Ipv4Address peer, const GossipDatagramHeader& header, const std::string& payload) {
+        Ptr<Packet> packet = Create<Packet>(reinterpret_cast<const uint8_t *>(payload.data()), payload.size());
+        packet->AddHeader(header);
+        m_socket->SendTo(packet, 0, InetSocketAddress(peer, 8080));
+        Counters().packetsSent++;
+        Counters().messageBytes += payload.size();
+    }
+
+    void SendAck(Ipv4Address peer, uint32_t seq) {
+        GossipDatagramHeader header;
+        header.type = GossipDatagramHeader::ACK;
+        header.seq = seq;
+        SendDatagram(peer, header, "");
+    }
+
+    // One timer per peer, always set to the earliest retransmission deadline
+    void RetransmitExpired(Ipv4Address peer) {
+        auto it = m_udpTx.find(peer);
+        if (!m_online || it == m_udpTx.end()) return;
+
+        UdpTxState& tx = it->second;
+        double now = Simulator::Now().GetSeconds();
+        double next = -1.0;
+        bool gaveUp = false;
+        for (auto entry = tx.unacked.begin(); entry != tx.unacked.end();) {
+            UnackedDatagram& pending = entry->second;
+            if (pending.deadline <= now) {
+                if (pending.retries >= m_udpMaxRetries) {
+                    Counters().datagramsAbandoned++;
+                    gaveUp = true;
+                    entry = tx.unacked.erase(entry);
+                    continue;
+                }
+                pending.retries++;
+                pending.deadline = now + m_udpRto.GetSeconds() * (1u << pending.retries);
+
+                GossipDatagramHeader header;
+                header.type = GossipDatagramHeader::DATA;
+                header.seq = entry->first;
+                SendDatagram(peer, header, pending.payload);
+                Counters().retransmits++;
+            }
+            next = next < 0 ? pending.deadline : std::min(next, pending.deadline);
+            ++entry;
+        }
+
+        if (next >= 0) {
+            tx.retransmitEvent = Schedule(Seconds(next - now), &TcpGossipApp::RetransmitExpired, this, peer);
+        }
+        if (gaveUp) {
+            MarkFailed(peer);
+        }
+    }
+
+    void FlushFecGroup(Ipv4Address peer) {
+        UdpTxState& tx = m_udpTx[peer];
+        Simulator::Cancel(tx.fecFlushEvent);
+        if (!m_online || tx.fecBlocks.empty()) return;
+
+        std::string parity;
+        for (const auto& block : tx.fecBlocks) {
+            XorInto(parity, block);
+        }
+
+        GossipDatagramHeader header;
+        header.type = GossipDatagramHeader::PARITY;
+        header.seq = tx.fecFirstSeq;
+        header.fecGroup = tx.fecGroup;
+        header.fecSize = tx.fecBlocks.size();
+        SendDatagram(peer, header, parity);
+
+        tx.fecGroup++;
+        tx.fecBlocks.clear();
+    }
+
+    void ResetDatagramsTo(UdpTxState& tx) {
+        Simulator::Cancel(tx.retransmitEvent);
+        Simulator::Cancel(tx.fecFlushEvent);
+        tx.unacked.clear();
+        if (!tx.fecBlocks.empty()) {
+            tx.fecGroup++;
+            tx.fecBlocks.clear();
+        }
+    }
+
+    // Hands a datagram's frames to the gossip logic unless it was delivered
+    // before (a retransmission whose ack got lost, or a repaired loss)
+    bool DeliverDatagram(Ipv4Address sender, uint32_t seq, const std::string& payload) {
+        UdpRxState& rx = m_udpRx[sender];
+        if (seq < rx.nextExpected || !rx.ahead.insert(seq).second) return false;
+
+        // A sender that gave up on a datagram leaves a gap that never fills
+        if (rx.ahead.size() > kRxWindow) {
+            rx.nextExpected = *rx.ahead.begin();
+        }
+        while (!rx.ahead.empty() && *rx.ahead.begin() == rx.nextExpected) {
+            rx.ahead.erase(rx.ahead.begin());
+            rx.nextExpected++;
+        }
+
+        std::string buffer = payload;
+        for (const auto& frame : TakeFrames(buffer)) {
+            HandleFrame(nullptr, sender, frame);
+        }
+        return true;
+    }
+
+    FecGroup& FecGroupFor(Ipv4Address sender, uint32_t groupId) {
+        std::map<uint32_t, FecGroup>& groups = m_udpRx[sender].fecGroups;
+        // Groups whose parity was lost are never resolved, forget the oldest
+        if (groups.size() >= kFecGroupsKept && groups.count(groupId) == 0) {
+            groups.erase(groups.begin());
+        }
+        return groups[groupId];
+    }
+
+    // With the parity and all but one datagram of a group, the missing one is
+    // the XOR of everything else
+    void TryFecRecovery(Ipv4Address sender, uint32_t groupId) {
+        std::map<uint32_t, FecGroup>& groups = m_udpRx[sender].fecGroups;
+        auto it = groups.find(groupId);
+        if (it == groups.end() || it->second.size == 0) return;
+
+        FecGroup& group = it->second;
+        if (group.blocks.size() >= group.size) {
+            groups.erase(it);
+            return;
+        }
+        if (group.blocks.size() + 1 < group.size) return;
+
+        uint8_t missing = 0;
+        while (group.blocks.count(missing) > 0) missing++;
+        std::string block = group.parity;
+        for (const auto& entry : group.blocks) {
+            XorInto(block, entry.second);
+        }
+        uint32_t seq = group.firstSeq + missing;
+        groups.erase(it);
+
+        if (block.size() < 2) return;
+        size_t length = (static_cast<uint8_t>(block[0]) << 8) | static_cast<uint8_t>(block[1]);
+        if (length + 2 > block.size()) return;
+
+        SendAck(sender, seq);
+        if (DeliverDatagram(sender, seq, block.substr(2, length))) {
+            Counters().fecRecovered++;
+        }
+    }
+
+    // Payload prefixed with its 16-bit length, so a block rebuilt from zero-padded
+    // parity knows where it ends
+    static std::string FecBlock(const std::string& payload) {
+        std::string block(2, '\0');
+        block[0] = static_cast<char>(payload.size() >> 8);
+        block[1] = static_cast<char>(payload.size() & 0xff);
+        return block + payload;
+    }
+
+    static void XorInto(std::string& acc, const std::string& block) {
+        if (acc.size() < block.size()) {
+            acc.resize(block.size(), '\0');
+        }
+        for (size_t i = 0; i < block.size(); i++) {
+            acc[i] ^= block[i];
+        }
+    }
+
+    void ArmProbe(Ipv4Address peer) {
+        if (!m_liveness) return;
+        PeerState& state = m_peerState[peer];
+        Simulator::Cancel(state.probeEvent);
+        // Random phase so the whole network doesn't probe in lockstep
+        double delay = m_probeInterval.GetSeconds() * (0.5 + (rand() % 1000) / 1000.0);
+        state.probeEvent = Schedule(Seconds(delay), &TcpGossipApp::ProbePeer, this, peer);
+    }
+
+    void ProbePeer(Ipv4Address peer) {
+        auto it = m_peerState.find(peer);
+        if (!m_online || it == m_peerState.end()) return;
+
+        PeerState& state = it->second;
+        bool silent = Simulator::Now().GetSeconds() - state.lastSeen >= m_probeInterval.GetSeconds();
+        if (silent && !state.probing) {
+            state.probing = true;
+            SendToPeer(peer, "PING");
+        }
+        state.probeEvent = Schedule(m_probeInterval, &TcpGossipApp::ProbePeer, this, peer);
+    }
+
+    void MarkAlive(Ipv4Address peer) {
+        auto it = m_peerState.find(peer);
+        if (it == m_peerState.end()) return;
+
+        it->second.lastSeen = Simulator::Now().GetSeconds();
+        it->second.failures = 0;
+        it->second.probing = false;
+    }
+
+    void MarkFailed(Ipv4Address peer) {
+        auto it = m_peerState.find(peer);
+        if (!m_liveness || it == m_peerState.end()) return;
+
+        it->second.probing = false;
+        if (++it->second.failures >= m_deadThreshold) {
+            DropPeer(peer);
+        }
+    }
+
+    void DropPeer(Ipv4Address peer) {
+        NS_LOG_INFO("Node " << m_nodeId << " dropping dead peer " << peer);
+        deadPeersDetected++;
+
+        Simulator::Cancel(m_peerState[peer].probeEvent);
+        m_peerState.erase(peer);
+        auto tx = m_udpTx.find(peer);
+        if (tx != m_udpTx.end()) {
+            ResetDatagramsTo(tx->second);
+        }
+        m_neighbors.erase(std::remove(m_neighbors.begin(), m_neighbors.end(), peer), m_neighbors.end());
+        TopUpNeighbors();
+    }
+
+    // Forget neighbors that are gone and fill the set back up to the target degree
+    void RefreshNeighbors() {
+        std::vector<Ipv4Address> alive;
+        for (const auto& neighbor : m_neighbors) {
+            if (BootstrapServer::IsOnline(neighbor)) {
+                alive.push_back(neighbor);
+            } else {
+                Simulator::Cancel(m_peerState[neighbor].probeEvent);
+                m_peerState.erase(neighbor);
+            }
+        }
+        m_neighbors = alive;
+        TopUpNeighbors();
+    }
+
+    void TopUpNeighbors() {
+        if (m_neighbors.size() >= m_targetDegree) return;
+
+        for (const auto& peer : BootstrapServer::Sample(m_targetDegree - m_neighbors.size(), m_myAddress, m_neighbors)) {
+            m_neighbors.push_back(peer);
+            m_peerState[peer].lastSeen = Simulator::Now().GetSeconds();
+            if (m_online) {
+                ArmProbe(peer);
+            }
         }
-        return 0;
     }
 };
 
+uint32_t TcpGossipApp::deadPeersDetected = 0;
+
 class MinerApp : public Application {
     private:
         EventId m_miningEvent;
         uint32_t m_blockCounter = 0;
         bool m_running = false;
+        bool m_started = false;
         Ptr<TcpGossipApp> m_gossipApp;
         double m_stopMiningTime = 0.0;
     
@@ -177,12 +1143,14 @@ class MinerApp : public Application {
     
         virtual void StartApplication() override {
             NS_LOG_INFO("MinerApp started on node " << GetNode()->GetId());
-            m_running = true;
+            m_started = true;
     
             // Stop mining 5 seconds before simulation ends
             // m_stopMiningTime = Simulator::GetStopTime().GetSeconds() - 5.0;
     
-            ScheduleNextMining();
+            // A node that churned out before its miner started waits for SetOnline(true)
+            if (m_gossipApp && !m_gossipApp->IsOnline()) return;
+            Resume();
         }
     
         virtual void StopApplication() override {
@@ -192,6 +1160,15 @@ class MinerApp : public Application {
             }
         }
     
+        // Used by the churn model: a miner stops hashing while its node is offline
+        void SetOnline(bool online) {
+            if (online) {
+                if (m_started) Resume();
+            } else {
+                StopApplication();
+            }
+        }
+    
         void SetSimulationStopTime(double stopTime) {
             m_stopMiningTime = stopTime - 20.0;
         }
@@ -205,6 +1182,13 @@ class MinerApp : public Application {
         }
     
     private:
+        // Never runs two mining chains at once
+        void Resume() {
+            m_running = true;
+            if (m_miningEvent.IsRunning()) return;
+            ScheduleNextMining();
+        }
+
         void ScheduleNextMining() {
             if (!m_running) return;
     
@@ -212,6 +1196,7 @@ class MinerApp : public Application {
             double nextMiningTime = Simulator::Now().GetSeconds() + interval;
     
             if (nextMiningTime < m_stopMiningTime) {
+                Instrumentation::For(GetNode()->GetId()).appEventsScheduled++;
                 m_miningEvent = Simulator::Schedule(Seconds(interval), &MinerApp::MineBlock, this);
             } else {
                 NS_LOG_INFO("Miner " << GetNode()->GetId() << " will not mine further to allow propagation.");
@@ -226,15 +1211,16 @@ class MinerApp : public Application {
             }
 
             m_blockCounter++;
-            std::string blockMsg = "Block_" + std::to_string(m_blockCounter) + "_" + std::to_string(GetNode()->GetId());
+            std::string blockMsg = BlockName(m_blockCounter, GetNode()->GetId());
     
             NS_LOG_INFO("Miner " << GetNode()->GetId() << " mined: " << blockMsg);
     
             totalBlocksMined++;
             perNodeMinedBlocks[GetNode()->GetId()]++;
+            uint32_t share = PropagationStats::OnMined(blockMsg, GetNode()->GetId());
     
             if (m_gossipApp) {
-                m_gossipApp->SendMessage(blockMsg);
+                m_gossipApp->SendMessage(share);
             }
     
             ScheduleNextMining();
@@ -244,20 +1230,181 @@ class MinerApp : public Application {
     // Static member initialization
     uint32_t MinerApp::totalBlocksMined = 0;
     std::map<uint32_t, uint32_t> MinerApp::perNodeMinedBlocks;
+
+// Takes a subset of the nodes offline and brings them back, with online session
+// lengths drawn from a configurable distribution and exponential downtimes
+class ChurnController {
+private:
+    std::vector<Ptr<TcpGossipApp>> m_gossipApps;
+    std::vector<Ptr<MinerApp>> m_minerApps;
+    Ptr<RandomVariableStream> m_session;
+    Ptr<ExponentialRandomVariable> m_downtime;
+
+public:
+    uint32_t departures = 0;
+    uint32_t rejoins = 0;
+
+    ChurnController(const std::vector<Ptr<TcpGossipApp>>& gossipApps,
+                    const std::vector<Ptr<MinerApp>>& minerApps,
+                    const std::string& sessionModel, double meanSession, double sessionShape,
+                    double meanDowntime)
+        : m_gossipApps(gossipApps), m_minerApps(minerApps) {
+        m_session = CreateSessionModel(sessionModel, meanSession, sessionShape);
+        m_downtime = CreateObject<ExponentialRandomVariable>();
+        m_downtime->SetAttribute("Mean", DoubleValue(meanDowntime));
+    }
+
+    // Picks `fraction` of the nodes at random; each one leaves after its first session
+    uint32_t Start(double fraction, double startTime) {
+        std::vector<uint32_t> order(m_gossipApps.size());
+        for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+        for (uint32_t i = order.size(); i > 1; i--) {
+            std::swap(order[i - 1], order[rand() % i]);
+        }
+
+        uint32_t churners = static_cast<uint32_t>(std::round(fraction * order.size()));
+        for (uint32_t i = 0; i < churners; i++) {
+            Simulator::Schedule(Seconds(startTime + m_session->GetValue()), &ChurnController::Depart, this, order[i]);
+        }
+        return churners;
+    }
+
+private:
+    static Ptr<RandomVariableStream> CreateSessionModel(const std::string& model, double mean, double shape) {
+        if (model == "exponential") {
+            Ptr<ExponentialRandomVariable> rv = CreateObject<ExponentialRandomVariable>();
+            rv->SetAttribute("Mean", DoubleValue(mean));
+            return rv;
+        }
+        if (model == "pareto") {
+            NS_ABORT_MSG_IF(shape <= 1.0, "Pareto session model needs shape > 1 for a finite mean");
+            Ptr<ParetoRandomVariable> rv = CreateObject<ParetoRandomVariable>();
+            rv->SetAttribute("Shape", DoubleValue(shape));
+            rv->SetAttribute("Scale", DoubleValue(mean * (shape - 1.0) / shape));
+            return rv;
+        }
+        if (model == "weibull") {
+            Ptr<WeibullRandomVariable> rv = CreateObject<WeibullRandomVariable>();
+            rv->SetAttribute("Shape", DoubleValue(shape));
+            rv->SetAttribute("Scale", DoubleValue(mean / std::tgamma(1.0 + 1.0 / shape)));
+            return rv;
+        }
+        NS_FATAL_ERROR("Unknown session model " << model << " (use exponential, pareto or weibull)");
+    }
+
+    void Depart(uint32_t i) {
+        m_gossipApps[i]->GoOffline();
+        m_minerApps[i]->SetOnline(false);
+        departures++;
+        Simulator::Schedule(Seconds(m_downtime->GetValue()), &ChurnController::Rejoin, this, i);
+    }
+
+    void Rejoin(uint32_t i) {
+        m_gossipApps[i]->GoOnline();
+        m_minerApps[i]->SetOnline(true);
+        rejoins++;
+        Simulator::Schedule(Seconds(m_session->GetValue()), &ChurnController::Depart, this, i);
+    }
+};
     
     
 
 int main(int argc, char *argv[]) {
     
     
-    srand(time(NULL)); 
-    
-    
+    uint32_t seed = 0;
     uint32_t numNodes = 20;
     uint32_t no_of_peers = 8;
     double simulationTime = 60.0;
 
-    LogComponentEnable("TcpGossip", LOG_LEVEL_INFO);
+    // Churn model (disabled by default)
+    double churnFraction = 0.0;
+    std::string sessionModel = "exponential";
+    double meanSession = 30.0;
+    double sessionShape = 2.0;
+    double meanDowntime = 10.0;
+    double probeInterval = 5.0;
+    uint32_t deadThreshold = 2;
+    uint32_t synRetries = 3;
+    double reportInterval = 0.0;
+    std::string summaryFile;
+    std::string nodeDetail;
+    uint32_t topK = 10;
+    bool verbose = false;
+
+    // Transport; the TCP values match ns-3's defaults, an empty tcpVariant keeps
+    // its congestion control (TcpCubic since ns-3.40)
+    std::string transport = "tcp";
+    std::string tcpVariant;
+    uint32_t tcpSegmentSize = 536;
+    uint32_t tcpInitialCwnd = 10;
+    bool tcpNoDelay = true;
+    uint32_t tcpDelAckCount = 2;
+    double tcpDelAckTimeout = 0.2;
+    double udpRto = 0.05;
+    uint32_t udpRetries = 4;
+    uint32_t fecGroup = 0;
+    double lossRate = 0.0;
+
+    CommandLine cmd;
+    cmd.AddValue("nodes", "Number of nodes", numNodes);
+    cmd.AddValue("seed", "Random seed (0 seeds from the clock)", seed);
+    cmd.AddValue("peers", "Number of peers per node", no_of_peers);
+    cmd.AddValue("simTime", "Simulation time in seconds", simulationTime);
+    cmd.AddValue("churnFraction", "Fraction of nodes that go offline and come back (0 disables churn)", churnFraction);
+    cmd.AddValue("sessionModel", "Online session length distribution: exponential, pareto or weibull", sessionModel);
+    cmd.AddValue("meanSession", "Mean online session length in seconds", meanSession);
+    cmd.AddValue("sessionShape", "Shape parameter for the pareto/weibull session models", sessionShape);
+    cmd.AddValue("meanDowntime", "Mean offline time in seconds", meanDowntime);
+    cmd.AddValue("probeInterval", "Seconds of silence before a neighbor is probed", probeInterval);
+    cmd.AddValue("deadThreshold", "Consecutive failed connections before a neighbor is dropped", deadThreshold);
+    cmd.AddValue("synRetries", "SYN retransmissions before a connection attempt fails", synRetries);
+    cmd.AddValue("reportInterval", "Print a progress line every this many simulated seconds (0 disables)", reportInterval);
+    cmd.AddValue("transport", "Gossip transport: tcp (connection per message) or udp (datagrams with ack/retransmit)", transport);
+    cmd.AddValue("tcpVariant", "TCP congestion control, e.g. TcpNewReno, TcpCubic, TcpBbr (default: ns-3's)", tcpVariant);
+    cmd.AddValue("tcpSegmentSize", "TCP maximum segment size in bytes", tcpSegmentSize);
+    cmd.AddValue("tcpInitialCwnd", "TCP initial congestion window in segments", tcpInitialCwnd);
+    cmd.AddValue("tcpNoDelay", "Disable Nagle's algorithm", tcpNoDelay);
+    cmd.AddValue("tcpDelAckCount", "Segments received before a delayed ACK is sent", tcpDelAckCount);
+    cmd.AddValue("tcpDelAckTimeout", "Delayed ACK timeout in seconds", tcpDelAckTimeout);
+    cmd.AddValue("udpRto", "Initial datagram retransmission timeout in seconds", udpRto);
+    cmd.AddValue("udpRetries", "Datagram retransmissions before giving up on a peer", udpRetries);
+    cmd.AddValue("fecGroup", "Send one XOR parity datagram per this many datagrams (0 disables FEC)", fecGroup);
+    cmd.AddValue("lossRate", "Probability that a received Wi-Fi frame is dropped", lossRate);
+    cmd.AddValue("summary", "Write the JSON run summary to this file instead of stdout", summaryFile);
+    cmd.AddValue("topK", "Number of slowest shares listed in the summary", topK);
+    cmd.AddValue("nodeDetail", "Also write a per-node CSV to this file", nodeDetail);
+    cmd.AddValue("verbose", "Log every connection, receive and mined block (slow on large runs)", verbose);
+    cmd.Parse(argc, argv);
+
+    srand(seed != 0 ? seed : time(NULL));
+    if (seed != 0) {
+        RngSeedManager::SetSeed(seed);
+    }
+
+    NS_ABORT_MSG_IF(no_of_peers >= numNodes, "peers must be fewer than nodes");
+    NS_ABORT_MSG_IF(transport != "tcp" && transport != "udp", "Unknown transport " << transport);
+    NS_ABORT_MSG_IF(fecGroup > 255, "fecGroup is at most 255");
+    bool udp = transport == "udp";
+
+    // With churn, connecting to a crashed peer should fail in seconds, not minutes
+    if (churnFraction > 0.0) {
+        Config::SetDefault("ns3::TcpSocket::ConnCount", UintegerValue(synRetries));
+    }
+
+    // For shares this small, first-delivery latency is mostly handshake,
+    // slow start, Nagle and delayed ACKs
+    if (!tcpVariant.empty()) {
+        Config::SetDefault("ns3::TcpL4Protocol::SocketType", TypeIdValue(TypeId::LookupByName("ns3::" + tcpVariant)));
+    }
+    Config::SetDefault("ns3::TcpSocket::SegmentSize", UintegerValue(tcpSegmentSize));
+    Config::SetDefault("ns3::TcpSocket::InitialCwnd", UintegerValue(tcpInitialCwnd));
+    Config::SetDefault("ns3::TcpSocket::TcpNoDelay", BooleanValue(tcpNoDelay));
+    Config::SetDefault("ns3::TcpSocket::DelAckCount", UintegerValue(tcpDelAckCount));
+    Config::SetDefault("ns3::TcpSocket::DelAckTimeout", TimeValue(Seconds(tcpDelAckTimeout)));
+
+    // Per-share INFO lines cost more than the gossip itself on big runs
+    LogComponentEnable("TcpGossip", verbose ? LOG_LEVEL_INFO : LOG_LEVEL_WARN);
 
     NodeContainer nodes;
     nodes.Create(numNodes);
@@ -280,13 +1427,24 @@ int main(int argc, char *argv[]) {
     internet.Install(nodes);
 
     Ipv4AddressHelper ipv4;
-    ipv4.SetBase("10.1.0.0", "255.255.0.0");
+    // A /16 runs out of addresses at 65534 nodes
+    ipv4.SetBase("10.0.0.0", "255.0.0.0");
     Ipv4InterfaceContainer interfaces = ipv4.Assign(devices);
 
     MobilityHelper mobility;
     mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
     mobility.Install(nodes);
 
+    if (lossRate > 0.0) {
+        Ptr<RateErrorModel> loss = CreateObject<RateErrorModel>();
+        loss->SetAttribute("ErrorRate", DoubleValue(lossRate));
+        loss->SetAttribute("ErrorUnit", StringValue("ERROR_UNIT_PACKET"));
+        Config::Set("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/PostReceptionErrorModel", PointerValue(loss));
+    }
+
+    Instrumentation::Init(numNodes);
+    PropagationStats::networkSize = numNodes;
+
     std::vector<Ptr<TcpGossipApp>> gossipApps(numNodes);
     std::vector<Ptr<MinerApp>> minerApps(numNodes);
 
@@ -294,6 +1452,12 @@ int main(int argc, char *argv[]) {
         gossipApps[i] = CreateObject<TcpGossipApp>(interfaces.GetAddress(i));
         nodes.Get(i)->AddApplication(gossipApps[i]);
         gossipApps[i]->SetStartTime(Seconds(0.5));
+        if (churnFraction > 0.0) {
+            gossipApps[i]->SetLivenessParams(Seconds(probeInterval), deadThreshold);
+        }
+        if (udp) {
+            gossipApps[i]->SetDatagramTransport(Seconds(udpRto), udpRetries, fecGroup);
+        }
     }
 
     for (uint32_t i = 0; i < numNodes; i++) {
@@ -316,31 +1480,64 @@ int main(int argc, char *argv[]) {
         
     }
 
+    ChurnController churn(gossipApps, minerApps, sessionModel, meanSession, sessionShape, meanDowntime);
+    uint32_t churningNodes = 0;
+    if (churnFraction > 0.0) {
+        churningNodes = churn.Start(churnFraction, 1.0);
+    }
+
+    ProgressReporter reporter;
+    if (reportInterval > 0.0) {
+        reporter.Start(Seconds(reportInterval));
+    }
+
     Simulator::Stop(Seconds(simulationTime));
     Simulator::Run();
 
-    // Print summary of blocks mined
-    std::cout << "\n=== BLOCKCHAIN NETWORK SUMMARY ===\n";
-    std::cout << "Total blocks mined across network: " << MinerApp::totalBlocksMined << "\n\n";
-    
-    // Print per-node mining statistics
-    std::cout << "Blocks mined by each node:\n";
-    for (const auto& pair : MinerApp::perNodeMinedBlocks) {
-        std::cout << "  Node " << pair.first << ": " << pair.second << " blocks\n";
-    }
-    
-   
-    std::unordered_set<std::string> uniqueBlocks;
+    // stdout carries only the JSON summary, progress and logging go to stderr
+    uint64_t eventsExecuted = Simulator::GetEventCount();
+    double simulatedTime = Simulator::Now().GetSeconds();
+
+    uint32_t catchUpReceived = 0;
     for (auto& app : gossipApps) {
-        const auto& messages = app->GetReceivedMessages();
-        uniqueBlocks.insert(messages.begin(), messages.end());
+        catchUpReceived += app->GetCatchUpReceived();
     }
-    
-    std::cout << "\nUnique blocks propagated in network: " << uniqueBlocks.size() << "\n";
-    
-    // Print received messages for each node
-    for (auto& app : gossipApps) {
-        app->PrintReceivedMessages();
+
+    std::ofstream summaryOut;
+    if (!summaryFile.empty()) {
+        summaryOut.open(summaryFile);
+        NS_ABORT_MSG_IF(!summaryOut, "Cannot open summary file " << summaryFile);
+    }
+    std::ostream& summary = summaryFile.empty() ? std::cout : summaryOut;
+    summary << "{\n  \"nodes\": " << numNodes
+            << ",\n  \"events_executed\": " << eventsExecuted
+            << ",\n  \"simulated_time\": " << simulatedTime
+            << ",\n  \"transport\": \"" << transport << "\""
+            << ",\n  \"blocks_mined\": " << MinerApp::totalBlocksMined
+            << ",\n  \"unique_blocks_propagated\": " << PropagationStats::shares.size()
+            << ",\n  \"propagation\": ";
+    PropagationStats::WriteJson(summary, topK);
+    if (churnFraction > 0.0) {
+        summary << ",\n  \"churn\": {\"churning_nodes\": " << churningNodes
+                << ", \"departures\": " << churn.departures
+                << ", \"rejoins\": " << churn.rejoins
+                << ", \"online_at_end\": " << BootstrapServer::OnlineCount()
+                << ", \"dead_peers_detected\": " << TcpGossipApp::deadPeersDetected
+                << ", \"catch_up_received\": " << catchUpReceived << "}";
+    }
+    summary << ",\n  \"instrumentation\": ";
+    Instrumentation::WriteJson(summary);
+    summary << "\n}\n";
+
+    // Per-node detail is O(nodes) lines, so it only goes to a file on request
+    if (!nodeDetail.empty()) {
+        std::ofstream detail(nodeDetail);
+        NS_ABORT_MSG_IF(!detail, "Cannot open node detail file " << nodeDetail);
+        detail << "node,address,online,received,catch_up,mined,neighbors\n";
+        for (uint32_t i = 0; i < numNodes; i++) {
+            gossipApps[i]->WriteDetail(detail, MinerApp::perNodeMinedBlocks[nodes.Get(i)->GetId()]);
+            detail << "\n";
+        }
     }
 
     Simulator::Destroy();
@@ -215,9 +215,23 @@
      uint32_t no_of_peers = 8; // Number of peers each node connects to
                                // (to add randomness, use: "+ rand() % x" where x = desired range)
      double simulationTime = 60.0;  // Duration of simulation in seconds
+     uint32_t seed = 1;             // Seed for peer selection and forwarding jitter
+     bool verbose = false;          // Log every send and receive
  
-     // Enable logging for this component
-     LogComponentEnable("TcpGossip", LOG_LEVEL_INFO);
+     // Command line overrides
+     CommandLine cmd;
+     cmd.AddValue("nodes", "Number of nodes", numNodes);
+     cmd.AddValue("peers", "Number of peers per node", no_of_peers);
+     cmd.AddValue("simTime", "Simulation time in seconds", simulationTime);
+     cmd.AddValue("seed", "Random seed", seed);
+     cmd.AddValue("verbose", "Log every send and receive (slow on large runs)", verbose);
+     cmd.Parse(argc, argv);
+     NS_ABORT_MSG_IF(no_of_peers >= numNodes, "peers must be fewer than nodes");  // peer selection would never finish
+     srand(seed);
+     RngSeedManager::SetSeed(seed);
+ 
+     // Enable logging for this component, per-message lines only on request
+     LogComponentEnable("TcpGossip", verbose ? LOG_LEVEL_INFO : LOG_LEVEL_WARN);
  
      // Create nodes
      NodeContainer nodes;
@@ -247,7 +261,7 @@
      
      // Assign IP addresses
      Ipv4AddressHelper ipv4;
-     ipv4.SetBase("10.1.0.0", "255.255.0.0");  // Uses 10.1.x.x address range
+     ipv4.SetBase("10.0.0.0", "255.0.0.0");  // Uses 10.x.x.x, a /16 runs out at 65534 nodes
      Ipv4InterfaceContainer interfaces = ipv4.Assign(devices);
  
      // Set up node positions (stationary nodes)
@@ -285,6 +299,10 @@
      // Run the simulation
      Simulator::Stop(Seconds(simulationTime));
      Simulator::Run();
+ 
+     // Used by GossipBenchmark to compute event rates
+     std::cout << "Events executed: " << Simulator::GetEventCount() << "\n";
+     std::cout << "Simulated time: " << Simulator::Now().GetSeconds() << "s\n";
      Simulator::Destroy();
      return 0;
  }
\ No newline at end of file
@@ -1,30 +1,124 @@
 // Core includes
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
-#include <unordered_set>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <fcntl.h>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
 #include <map>
 
+#include "gossip/hot-path.h"
+#include "gossip/stats.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("SimpleGossipSimulation");
 
+// splitmix64. The whole state is one 64-bit word, so it can be written to a
+// checkpoint and picked up again in another process.
+class GossipRng {
+public:
+    explicit GossipRng(uint64_t seed = 0) : m_state(seed) {}
+
+    uint64_t Next() {
+        uint64_t z = (m_state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    uint32_t Below(uint32_t n) { return Next() % n; }
+
+    uint64_t GetState() const { return m_state; }
+    void SetState(uint64_t state) { m_state = state; }
+
+private:
+    uint64_t m_state;
+};
+
+// Delay of one gossip message: a fixed base plus jitter. Uniform jitter is in 1ms
+// steps below `scale`; exponential jitter has the same mean, scale / 2.
+struct DelayModel {
+    double base = 0.05;
+    double scale = 1.0;
+    bool exponential = false;
+
+    // `bits` is one 64-bit random draw
+    double FromBits(uint64_t bits) const {
+        if (exponential) {
+            double unit = (bits >> 11) * (1.0 / 9007199254740992.0);
+            return base - 0.5 * scale * std::log1p(-unit);
+        }
+        return base + scale * ((double)(bits % 1000) / 1000.0);
+    }
+};
+
+// Running propagation statistics of one share, updated on every first receive
+struct ShareStats {
+    uint32_t origin = 0;
+    double createdAt = 0.0;
+    uint32_t receivers = 0;
+    uint64_t hopSum = 0;
+    uint32_t maxHop = 0;
+    uint64_t messages = 0;       // deliveries scheduled, duplicates included
+    double lastReceiveAt = 0.0;
+    double time50 = -1.0;        // time to reach half / 90% / all of the nodes, -1 if never
+    double time90 = -1.0;
+    double time100 = -1.0;
+};
+
+// A share that has been sent but not yet received. Only tracked when a
+// checkpoint is requested, since the scheduler's queue can't be inspected.
+struct PendingDelivery {
+    double time;
+    uint32_t receiver;
+    uint32_t sender;
+    uint32_t share;
+    uint32_t hopCount;
+};
+
 class GossipApp : public Application {
 public:
     GossipApp();
     virtual ~GossipApp();
     void Setup(uint32_t nodeId, Ptr<Node> node, const std::vector<uint32_t>& peers);
     void SendShare(const std::string& shareMsg);
+    static void ScheduleDelivery(uint32_t receiverId, uint32_t senderId, uint32_t share, uint32_t hopCount, double delay);
+    static double Now();
+    static uint64_t NextSequence();
     static std::map<uint32_t, std::vector<uint32_t>> peerList;
-    static std::map<uint32_t, std::unordered_set<std::string>> receivedShares;
-    static std::map<std::string, std::unordered_set<uint32_t>> shareReceivers;
-    static std::map<std::string, std::vector<uint32_t>> shareHopCounts;
+    static ShareIds shareIds;
+    static std::vector<SeenShares> receivedShares;   // by node
+    static std::vector<ShareStats> shareStats;       // by share id
+    static Histogram latencyHistogram;   // seconds from creation to each first receive
+    static Histogram hopHistogram;
+    static uint32_t networkSize;
     static uint32_t totalUniqueReceives;
 
+    static GossipRng delayRng;
+    static DelayModel delayModel;
+    static uint32_t fanout;        // forward to this many random peers, 0 = all of them
+    static double timeBase;        // absolute time at which this process' simulation started
+    static bool trackPending;
+    static std::unordered_map<uint64_t, PendingDelivery> pendingDeliveries;
+
 private:
     virtual void StartApplication() override;
     virtual void StopApplication() override;
 
-    static void ReceiveShare(uint32_t receiverId, uint32_t senderId, std::string shareMsg, uint32_t hopCount);
+    static void ReceiveShare(uint32_t receiverId, uint32_t senderId, uint32_t share, uint32_t hopCount, uint64_t deliveryId);
+    static ShareStats& RecordReceive(uint32_t share, uint32_t hopCount);
+    static void Forward(uint32_t nodeId, uint32_t senderId, uint32_t share, uint32_t hopCount, ShareStats& stats);
+
+    static uint64_t s_nextSequence;
 
     uint32_t m_nodeId;
     Ptr<Node> m_node;
@@ -36,7 +130,12 @@ class MinerApp : public Application {
 public:
     MinerApp();
     virtual ~MinerApp();
-    void Setup(uint32_t nodeId, Ptr<GossipApp> gossip);
+    void Setup(uint32_t nodeId, Ptr<GossipApp> gossip, uint64_t seed);
+    void RestoreState(uint64_t rngState, double nextMineTime);
+    void ResumeMining();
+    uint64_t GetRngState() const;
+    double GetNextMineTime() const;
+    uint64_t GetNextMineSequence() const;
 
 private:
     virtual void StartApplication() override;
@@ -47,13 +146,155 @@ private:
     uint32_t m_nodeId;
     Ptr<GossipApp> m_gossipApp;
     EventId m_miningEvent;
+    GossipRng m_rng;
+    double m_nextMineTime = -1.0;
+    uint64_t m_nextMineSequence = 0;
+    bool m_restored = false;
+};
+
+// One share from a recorded sharechain
+struct TraceRecord {
+    double timestamp;         // seconds, trace clock
+    std::string miner;
+    uint32_t size;            // bytes
+    std::string parent;
+};
+
+// Replays a recorded share-arrival trace through GossipApp::SendShare instead of
+// the random miners. The trace is a CSV of "timestamp,miner,size,parent" lines
+// that is read lazily: at most `lookahead` records are in memory and only the
+// next share has an event scheduled.
+class TraceReplayer {
+public:
+    TraceReplayer(const std::string& path, uint32_t lookahead, double speed, const std::string& minerMap,
+                  const std::vector<Ptr<GossipApp>>& gossipApps);
+    void Start(double startTime);
+    void WriteJson(std::ostream& os) const;
+
+private:
+    void Refill();
+    bool ParseLine(const std::string& line, TraceRecord& record);
+    uint32_t MapMiner(const std::string& miner);
+    void ScheduleNext();
+    void Inject();
+
+    std::ifstream m_trace;
+    std::deque<TraceRecord> m_buffer;
+    uint32_t m_lookahead;
+    double m_speed;
+    double m_startTime = 0.0;
+    double m_firstTimestamp = -1.0;
+    std::vector<Ptr<GossipApp>> m_gossipApps;
+
+    std::string m_mapMode;
+    std::unordered_map<std::string, uint32_t> m_minerToNode;
+    uint32_t m_nextNode = 0;
+
+    uint64_t m_lineNumber = 0;
+    bool m_headerAllowed = true;   // only until the first non-comment line
+    uint64_t m_replayed = 0;
+    uint64_t m_late = 0;
+    uint64_t m_malformed = 0;
+    uint64_t m_bytes = 0;
 };
 
+// On-disk checkpoint layout. Every section is 8-byte aligned and located by its
+// offset from the start of the file, so a restore can mmap the file and read the
+// arrays in place. Native byte order.
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t numNodes;
+    uint32_t numShares;
+    uint32_t reserved;
+    double time;
+    uint64_t delayRngState;
+    uint64_t numPeers;
+    uint64_t numSeen;
+    uint64_t numPending;
+    uint64_t peerOffsetsAt;   // uint64_t[numNodes + 1] into peers
+    uint64_t peersAt;         // uint32_t[numPeers]
+    uint64_t shareOffsetsAt;  // uint64_t[numShares + 1] into shareChars
+    uint64_t shareCharsAt;
+    uint64_t seenOffsetsAt;   // uint64_t[numNodes + 1] into seen
+    uint64_t seenAt;          // uint32_t[numSeen], share ids each node has seen, sorted per node
+    uint64_t sharesAt;        // CheckpointShare[numShares]
+    uint64_t histogramsAt;    // serialized latency histogram, then hop histogram
+    uint64_t minersAt;        // CheckpointMiner[numNodes]
+    uint64_t pendingAt;       // CheckpointPending[numPending]
+};
+
+struct CheckpointShare {
+    double createdAt;
+    double lastReceiveAt;
+    double time50;
+    double time90;
+    double time100;
+    uint64_t hopSum;
+    uint64_t messages;
+    uint32_t origin;
+    uint32_t receivers;
+    uint32_t maxHop;
+    uint32_t reserved;
+};
+
+// Events carry the order in which they were scheduled, so a restore can
+// re-schedule them in the same order and simultaneous events still run as they
+// would have in the original process.
+struct CheckpointMiner {
+    uint64_t rngState;
+    double nextMineTime;      // absolute, < 0 if nothing scheduled
+    uint64_t sequence;
+};
+
+struct CheckpointPending {
+    double time;              // absolute delivery time
+    uint64_t sequence;
+    uint32_t receiver;
+    uint32_t sender;
+    uint32_t share;
+    uint32_t hopCount;
+};
+
+static const char kCheckpointMagic[8] = {'G', 'O', 'S', 'S', 'I', 'P', 'C', 'K'};
+static const uint32_t kCheckpointVersion = 4;
+
+// Read-only view of a checkpoint file mapped into memory
+class CheckpointImage {
+public:
+    ~CheckpointImage();
+    void Open(const std::string& path);
+
+    const CheckpointHeader& Header() const { return *reinterpret_cast<const CheckpointHeader*>(m_base); }
+    std::vector<uint32_t> Peers(uint32_t nodeId) const;
+    std::string_view Share(uint32_t shareId) const;
+
+    template <typename T>
+    const T* Section(uint64_t offset) const { return reinterpret_cast<const T*>(m_base + offset); }
+
+private:
+    const uint8_t* m_base = nullptr;
+    size_t m_size = 0;
+};
+
+void WriteCheckpoint(const std::string& path, std::vector<Ptr<MinerApp>> minerApps);
+void RestoreCheckpoint(const CheckpointImage& image, const std::vector<Ptr<MinerApp>>& minerApps);
+
 std::map<uint32_t, std::vector<uint32_t>> GossipApp::peerList;
-std::map<uint32_t, std::unordered_set<std::string>> GossipApp::receivedShares;
-std::map<std::string, std::unordered_set<uint32_t>> GossipApp::shareReceivers;
-std::map<std::string, std::vector<uint32_t>> GossipApp::shareHopCounts;
+ShareIds GossipApp::shareIds;
+std::vector<SeenShares> GossipApp::receivedShares;
+std::vector<ShareStats> GossipApp::shareStats;
+Histogram GossipApp::latencyHistogram(0.01, 3000);
+Histogram GossipApp::hopHistogram(1.0, 64);
+uint32_t GossipApp::networkSize = 0;
 uint32_t GossipApp::totalUniqueReceives = 0;
+GossipRng GossipApp::delayRng;
+DelayModel GossipApp::delayModel;
+uint32_t GossipApp::fanout = 0;
+double GossipApp::timeBase = 0.0;
+bool GossipApp::trackPending = false;
+std::unordered_map<uint64_t, PendingDelivery> GossipApp::pendingDeliveries;
+uint64_t GossipApp::s_nextSequence = 1;
 
 GossipApp::GossipApp() {}
 GossipApp::~GossipApp() {}
@@ -68,59 +309,137 @@ void GossipApp::Setup(uint32_t nodeId, Ptr<Node> node, const std::vector<uint32_
 void GossipApp::StartApplication() {}
 void GossipApp::StopApplication() {}
 
+double GossipApp::Now() {
+    return (Seconds(timeBase) + Simulator::Now()).GetSeconds();
+}
+
+uint64_t GossipApp::NextSequence() {
+    return s_nextSequence++;
+}
+
 void GossipApp::SendShare(const std::string& shareMsg) {
-    if (receivedShares[m_nodeId].count(shareMsg)) return;
-    receivedShares[m_nodeId].insert(shareMsg);
-    shareReceivers[shareMsg].insert(m_nodeId);
-    shareHopCounts[shareMsg].push_back(0);
-    totalUniqueReceives++;
+    uint32_t share = shareIds.Intern(shareMsg);
+    if (share == shareStats.size()) shareStats.emplace_back();
+    if (!receivedShares[m_nodeId].Insert(share)) return;
+    ShareStats& stats = shareStats[share];
+    stats.origin = m_nodeId;
+    stats.createdAt = Now();
+    RecordReceive(share, 0);
+    Forward(m_nodeId, m_nodeId, share, 1, stats);
+}
 
-    for (uint32_t peer : m_peers) {
-        Simulator::ScheduleWithContext(
-            peer,
-            Seconds(0.05 + ((double)(rand() % 1000) / 1000.0)),
-            &GossipApp::ReceiveShare,
-            peer,
-            m_nodeId,
-            shareMsg,
-            1
-        );
+// Events carry the interned share id, not the name
+void GossipApp::ScheduleDelivery(uint32_t receiverId, uint32_t senderId, uint32_t share, uint32_t hopCount, double delay) {
+    uint64_t deliveryId = 0;
+    if (trackPending) {
+        deliveryId = NextSequence();
+        pendingDeliveries[deliveryId] = {Now() + delay, receiverId, senderId, share, hopCount};
     }
+
+    Simulator::ScheduleWithContext(
+        receiverId,
+        Seconds(delay),
+        &GossipApp::ReceiveShare,
+        receiverId,
+        senderId,
+        share,
+        hopCount,
+        deliveryId
+    );
 }
 
-void GossipApp::ReceiveShare(uint32_t receiverId, uint32_t senderId, std::string shareMsg, uint32_t hopCount) {
-    if (receivedShares[receiverId].count(shareMsg)) return;
-    receivedShares[receiverId].insert(shareMsg);
-    shareReceivers[shareMsg].insert(receiverId);
-    shareHopCounts[shareMsg].push_back(hopCount);
-    totalUniqueReceives++;
-    NS_LOG_INFO("[Receive] Node " << receiverId << " received share from Node " << senderId << " (hop: " << hopCount << "): " << shareMsg);
+void GossipApp::ReceiveShare(uint32_t receiverId, uint32_t senderId, uint32_t share, uint32_t hopCount, uint64_t deliveryId) {
+    if (deliveryId != 0) pendingDeliveries.erase(deliveryId);
 
-    for (uint32_t peer : peerList[receiverId]) {
-        if (peer != senderId) {
-            Simulator::ScheduleWithContext(
-                peer,
-                Seconds(0.05 + ((double)(rand() % 1000) / 1000.0)),
-                &GossipApp::ReceiveShare,
-                peer,
-                receiverId,
-                shareMsg,
-                hopCount + 1
-            );
+    if (!receivedShares[receiverId].Insert(share)) return;
+    ShareStats& stats = RecordReceive(share, hopCount);
+    NS_LOG_INFO("[Receive] Node " << receiverId << " received share from Node " << senderId << " (hop: " << hopCount << "): " << shareIds.Name(share));
+
+    Forward(receiverId, senderId, share, hopCount + 1, stats);
+}
+
+// Sends to every peer but the one the share came from, or to `fanout` of them
+void GossipApp::Forward(uint32_t nodeId, uint32_t senderId, uint32_t share, uint32_t hopCount, ShareStats& stats) {
+    const std::vector<uint32_t>& peers = peerList[nodeId];
+    if (fanout == 0) {
+        for (uint32_t peer : peers) {
+            if (peer != senderId) {
+                ScheduleDelivery(peer, nodeId, share, hopCount, delayModel.FromBits(delayRng.Next()));
+                stats.messages++;
+            }
         }
+        return;
     }
+
+    std::vector<uint32_t> eligible;
+    for (uint32_t peer : peers) {
+        if (peer != senderId) eligible.push_back(peer);
+    }
+    uint32_t count = std::min<size_t>(fanout, eligible.size());
+    for (uint32_t i = 0; i < count; i++) {
+        std::swap(eligible[i], eligible[i + delayRng.Below(eligible.size() - i)]);
+        ScheduleDelivery(eligible[i], nodeId, share, hopCount, delayModel.FromBits(delayRng.Next()));
+        stats.messages++;
+    }
+}
+
+ShareStats& GossipApp::RecordReceive(uint32_t share, uint32_t hopCount) {
+    ShareStats& stats = shareStats[share];
+    double now = Now();
+    stats.receivers++;
+    stats.hopSum += hopCount;
+    stats.maxHop = std::max(stats.maxHop, hopCount);
+    stats.lastReceiveAt = now;
+    if (stats.time50 < 0 && 2 * stats.receivers >= networkSize) stats.time50 = now - stats.createdAt;
+    if (stats.time90 < 0 && 10 * stats.receivers >= 9 * networkSize) stats.time90 = now - stats.createdAt;
+    if (stats.time100 < 0 && stats.receivers >= networkSize) stats.time100 = now - stats.createdAt;
+
+    latencyHistogram.Add(now - stats.createdAt);
+    hopHistogram.Add(hopCount);
+    totalUniqueReceives++;
+    return stats;
 }
 
 MinerApp::MinerApp() {}
 MinerApp::~MinerApp() {}
 
-void MinerApp::Setup(uint32_t nodeId, Ptr<GossipApp> gossip) {
+void MinerApp::Setup(uint32_t nodeId, Ptr<GossipApp> gossip, uint64_t seed) {
     m_nodeId = nodeId;
     m_gossipApp = gossip;
+    m_rng.SetState(seed * 0x100000001B3ULL + nodeId);
+}
+
+void MinerApp::RestoreState(uint64_t rngState, double nextMineTime) {
+    m_rng.SetState(rngState);
+    m_nextMineTime = nextMineTime;
+    m_restored = true;
+}
+
+void MinerApp::ResumeMining() {
+    if (m_nextMineTime < 0) return;
+    m_nextMineSequence = GossipApp::NextSequence();
+    m_miningEvent = Simulator::Schedule(Seconds(m_nextMineTime - GossipApp::Now()), &MinerApp::MineShare, this);
+}
+
+uint64_t MinerApp::GetRngState() const {
+    return m_rng.GetState();
+}
+
+double MinerApp::GetNextMineTime() const {
+    return m_nextMineTime;
+}
+
+uint64_t MinerApp::GetNextMineSequence() const {
+    return m_nextMineSequence;
 }
 
 void MinerApp::StartApplication() {
-    double startDelay = rand() % 10;
+    // Mining was already resumed by RestoreCheckpoint
+    if (m_restored) return;
+
+    double startDelay = m_rng.Below(10);
+    m_nextMineTime = GossipApp::Now() + startDelay;
+    m_nextMineSequence = GossipApp::NextSequence();
     m_miningEvent = Simulator::Schedule(Seconds(startDelay), &MinerApp::MineShare, this);
 }
 
@@ -129,74 +448,952 @@ void MinerApp::StopApplication() {
 }
 
 void MinerApp::MineShare() {
-    std::string share = "Share_" + std::to_string(m_nodeId) + "_" + std::to_string(Simulator::Now().GetSeconds());
-    m_gossipApp->SendShare(share);
+    m_gossipApp->SendShare(ShareName(m_nodeId, GossipApp::Now()));
 
-    double nextTime = 10 + (rand() % 5);
+    double nextTime = 10 + m_rng.Below(5);
+    m_nextMineTime = GossipApp::Now() + nextTime;
+    m_nextMineSequence = GossipApp::NextSequence();
     m_miningEvent = Simulator::Schedule(Seconds(nextTime), &MinerApp::MineShare, this);
 }
 
+TraceReplayer::TraceReplayer(const std::string& path, uint32_t lookahead, double speed, const std::string& minerMap,
+                             const std::vector<Ptr<GossipApp>>& gossipApps)
+    : m_trace(path), m_lookahead(std::max<uint32_t>(lookahead, 1)), m_speed(speed), m_gossipApps(gossipApps) {
+    NS_ABORT_MSG_IF(!m_trace, "Could not open trace " << path);
+    NS_ABORT_MSG_IF(speed <= 0, "replaySpeed must be positive");
+
+    // "hash" and "roundrobin" map miners on the fly; "file:<path>" reads
+    // "miner,node" pairs up front and falls back to hashing for the rest
+    if (minerMap.rfind("file:", 0) == 0) {
+        std::ifstream mapping(minerMap.substr(5));
+        NS_ABORT_MSG_IF(!mapping, "Could not open miner map " << minerMap.substr(5));
+        std::string line;
+        uint64_t lineNumber = 0;
+        while (std::getline(mapping, line)) {
+            lineNumber++;
+            size_t comma = line.find(',');
+            if (line.empty() || line[0] == '#' || comma == std::string::npos) continue;
+
+            const char* text = line.c_str() + comma + 1;
+            char* end = nullptr;
+            unsigned long node = std::strtoul(text, &end, 10);
+            NS_ABORT_MSG_IF(end == text || *end != '\0',
+                            "Bad node \"" << text << "\" on miner map line " << lineNumber);
+            NS_ABORT_MSG_IF(node >= gossipApps.size(),
+                            "Node " << node << " on miner map line " << lineNumber << " is out of range (nodes=" << gossipApps.size() << ")");
+            m_minerToNode[line.substr(0, comma)] = node;
+        }
+        m_mapMode = "hash";
+    } else {
+        NS_ABORT_MSG_IF(minerMap != "hash" && minerMap != "roundrobin", "Unknown minerMap " << minerMap);
+        m_mapMode = minerMap;
+    }
+}
+
+void TraceReplayer::Start(double startTime) {
+    m_startTime = startTime;
+    Refill();
+    ScheduleNext();
+}
+
+void TraceReplayer::Refill() {
+    std::string line;
+    while (m_buffer.size() < m_lookahead && std::getline(m_trace, line)) {
+        m_lineNumber++;
+        TraceRecord record;
+        if (ParseLine(line, record)) {
+            m_buffer.push_back(record);
+        }
+    }
+}
+
+bool TraceReplayer::ParseLine(const std::string& line, TraceRecord& record) {
+    if (line.empty() || line[0] == '#') return false;
+    bool mayBeHeader = m_headerAllowed;
+    m_headerAllowed = false;
+
+    std::stringstream ss(line);
+    std::string timestamp, size;
+    if (!std::getline(ss, timestamp, ',') || !std::getline(ss, record.miner, ',') ||
+        !std::getline(ss, size, ',')) {
+        NS_LOG_WARN("Skipping malformed trace line " << m_lineNumber);
+        m_malformed++;
+        return false;
+    }
+    std::getline(ss, record.parent);
+
+    char* end = nullptr;
+    record.timestamp = std::strtod(timestamp.c_str(), &end);
+    if (end == timestamp.c_str()) {
+        if (mayBeHeader) return false;
+        NS_LOG_WARN("Skipping trace line " << m_lineNumber << " with a non-numeric timestamp");
+        m_malformed++;
+        return false;
+    }
+    record.size = std::strtoul(size.c_str(), nullptr, 10);
+    return true;
+}
+
+uint32_t TraceReplayer::MapMiner(const std::string& miner) {
+    auto it = m_minerToNode.find(miner);
+    if (it != m_minerToNode.end()) return it->second;
+
+    uint32_t node;
+    if (m_mapMode == "roundrobin") {
+        node = m_nextNode++ % m_gossipApps.size();
+    } else {
+        // FNV-1a, so the mapping is the same on every platform
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (unsigned char c : miner) {
+            hash = (hash ^ c) * 0x100000001b3ULL;
+        }
+        node = hash % m_gossipApps.size();
+    }
+    m_minerToNode[miner] = node;
+    return node;
+}
+
+void TraceReplayer::ScheduleNext() {
+    if (m_buffer.empty()) return;
+
+    const TraceRecord& next = m_buffer.front();
+    if (m_firstTimestamp < 0) m_firstTimestamp = next.timestamp;
+
+    double due = m_startTime + (next.timestamp - m_firstTimestamp) / m_speed;
+    double delay = due - GossipApp::Now();
+    if (delay < 0) {
+        // Out-of-order record, send it right away
+        m_late++;
+        delay = 0;
+    }
+    Simulator::Schedule(Seconds(delay), &TraceReplayer::Inject, this);
+}
+
+void TraceReplayer::Inject() {
+    TraceRecord record = m_buffer.front();
+    m_buffer.pop_front();
+
+    uint32_t node = MapMiner(record.miner);
+    // Records from one miner can share a timestamp, the sequence number keeps their ids apart
+    std::string share = ShareName(node, GossipApp::Now()) + "_" + std::to_string(m_replayed);
+    NS_LOG_INFO("[Replay] " << record.miner << " -> node " << node << ": " << share << " (" << record.size
+                            << " bytes, parent " << record.parent << ")");
+    m_gossipApps[node]->SendShare(share);
+    m_replayed++;
+    m_bytes += record.size;
+
+    if (m_buffer.size() < m_lookahead / 2 + 1) Refill();
+    ScheduleNext();
+}
+
+void TraceReplayer::WriteJson(std::ostream& os) const {
+    os << "{\"shares\": " << m_replayed << ", \"bytes\": " << m_bytes
+       << ", \"miners\": " << m_minerToNode.size() << ", \"out_of_order\": " << m_late
+       << ", \"malformed\": " << m_malformed << ", \"buffered_at_stop\": " << m_buffer.size() << "}";
+}
+
+// Writes the gossip-level state of the running simulation: topology, seen-share
+// tables, share statistics, RNG states, next mining times and in-flight shares
+void WriteCheckpoint(const std::string& path, std::vector<Ptr<MinerApp>> minerApps) {
+    uint32_t numNodes = minerApps.size();
+
+    // Shares are stored under their interned ids
+    uint32_t numShares = GossipApp::shareIds.Size();
+
+    std::vector<uint64_t> peerOffsets{0};
+    std::vector<uint32_t> peers;
+    std::vector<uint64_t> seenOffsets{0};
+    std::vector<uint32_t> seen;
+    for (uint32_t i = 0; i < numNodes; i++) {
+        const auto& nodePeers = GossipApp::peerList[i];
+        peers.insert(peers.end(), nodePeers.begin(), nodePeers.end());
+        peerOffsets.push_back(peers.size());
+
+        GossipApp::receivedShares[i].ForEach([&seen](uint32_t share) { seen.push_back(share); });
+        // Sorted, so a restore can search the mapped list directly
+        std::sort(seen.begin() + seenOffsets.back(), seen.end());
+        seenOffsets.push_back(seen.size());
+    }
+
+    std::vector<uint64_t> shareOffsets{0};
+    std::string shareChars;
+    std::vector<CheckpointShare> shareTable;
+    for (uint32_t share = 0; share < numShares; share++) {
+        shareChars += GossipApp::shareIds.Name(share);
+        shareOffsets.push_back(shareChars.size());
+        const ShareStats& st = GossipApp::shareStats[share];
+        shareTable.push_back({st.createdAt, st.lastReceiveAt, st.time50, st.time90, st.time100,
+                              st.hopSum, st.messages, st.origin, st.receivers, st.maxHop, 0});
+    }
+
+    std::vector<uint64_t> histograms = GossipApp::latencyHistogram.Serialize();
+    std::vector<uint64_t> hopHistogram = GossipApp::hopHistogram.Serialize();
+    histograms.insert(histograms.end(), hopHistogram.begin(), hopHistogram.end());
+
+    std::vector<CheckpointMiner> miners;
+    for (const auto& miner : minerApps) {
+        miners.push_back({miner->GetRngState(), miner->GetNextMineTime(), miner->GetNextMineSequence()});
+    }
+
+    std::vector<CheckpointPending> pending;
+    for (const auto& [id, delivery] : GossipApp::pendingDeliveries) {
+        pending.push_back({delivery.time, id, delivery.receiver, delivery.sender, delivery.share, delivery.hopCount});
+    }
+    std::sort(pending.begin(), pending.end(), [](const CheckpointPending& a, const CheckpointPending& b) {
+        return a.sequence < b.sequence;
+    });
+
+    CheckpointHeader header = {};
+    std::copy(kCheckpointMagic, kCheckpointMagic + 8, header.magic);
+    header.version = kCheckpointVersion;
+    header.numNodes = numNodes;
+    header.numShares = numShares;
+    header.time = GossipApp::Now();
+    header.delayRngState = GossipApp::delayRng.GetState();
+    header.numPeers = peers.size();
+    header.numSeen = seen.size();
+    header.numPending = pending.size();
+
+    // Lay the sections out back to back, each one 8-byte aligned
+    uint64_t cursor = sizeof(CheckpointHeader);
+    auto place = [&cursor](uint64_t bytes) {
+        uint64_t at = cursor;
+        cursor = (cursor + bytes + 7) & ~uint64_t(7);
+        return at;
+    };
+    header.peerOffsetsAt = place(peerOffsets.size() * sizeof(uint64_t));
+    header.peersAt = place(peers.size() * sizeof(uint32_t));
+    header.shareOffsetsAt = place(shareOffsets.size() * sizeof(uint64_t));
+    header.shareCharsAt = place(shareChars.size());
+    header.seenOffsetsAt = place(seenOffsets.size() * sizeof(uint64_t));
+    header.seenAt = place(seen.size() * sizeof(uint32_t));
+    header.sharesAt = place(shareTable.size() * sizeof(CheckpointShare));
+    header.histogramsAt = place(histograms.size() * sizeof(uint64_t));
+    header.minersAt = place(miners.size() * sizeof(CheckpointMiner));
+    header.pendingAt = place(pending.size() * sizeof(CheckpointPending));
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    NS_ABORT_MSG_IF(!out, "Could not open checkpoint file " << path);
+    auto write = [&out](uint64_t at, const void* data, uint64_t bytes) {
+        out.seekp(at);
+        out.write(static_cast<const char*>(data), bytes);
+    };
+    write(0, &header, sizeof(header));
+    write(header.peerOffsetsAt, peerOffsets.data(), peerOffsets.size() * sizeof(uint64_t));
+    write(header.peersAt, peers.data(), peers.size() * sizeof(uint32_t));
+    write(header.shareOffsetsAt, shareOffsets.data(), shareOffsets.size() * sizeof(uint64_t));
+    write(header.shareCharsAt, shareChars.data(), shareChars.size());
+    write(header.seenOffsetsAt, seenOffsets.data(), seenOffsets.size() * sizeof(uint64_t));
+    write(header.seenAt, seen.data(), seen.size() * sizeof(uint32_t));
+    write(header.sharesAt, shareTable.data(), shareTable.size() * sizeof(CheckpointShare));
+    write(header.histogramsAt, histograms.data(), histograms.size() * sizeof(uint64_t));
+    write(header.minersAt, miners.data(), miners.size() * sizeof(CheckpointMiner));
+    write(header.pendingAt, pending.data(), pending.size() * sizeof(CheckpointPending));
+
+    std::cerr << "Checkpoint written to " << path << " at t=" << header.time << "s: "
+              << numShares << " shares, " << pending.size() << " in flight, " << out.tellp() << " bytes\n";
+}
+
+CheckpointImage::~CheckpointImage() {
+    if (m_base) munmap(const_cast<uint8_t*>(m_base), m_size);
+}
+
+void CheckpointImage::Open(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    NS_ABORT_MSG_IF(fd < 0, "Could not open checkpoint file " << path);
+    struct stat st;
+    fstat(fd, &st);
+    m_size = st.st_size;
+    NS_ABORT_MSG_IF(m_size < sizeof(CheckpointHeader), "Checkpoint file " << path << " is truncated");
+
+    void* base = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    NS_ABORT_MSG_IF(base == MAP_FAILED, "Could not map checkpoint file " << path);
+    m_base = static_cast<const uint8_t*>(base);
+
+    const CheckpointHeader& header = Header();
+    NS_ABORT_MSG_IF(!std::equal(kCheckpointMagic, kCheckpointMagic + 8, header.magic), path << " is not a gossip checkpoint");
+    NS_ABORT_MSG_IF(header.version != kCheckpointVersion, "Unsupported checkpoint version " << header.version);
+    NS_ABORT_MSG_IF(header.pendingAt + header.numPending * sizeof(CheckpointPending) > m_size,
+                    "Checkpoint file " << path << " is truncated");
+}
+
+std::vector<uint32_t> CheckpointImage::Peers(uint32_t nodeId) const {
+    const uint64_t* offsets = Section<uint64_t>(Header().peerOffsetsAt);
+    const uint32_t* peers = Section<uint32_t>(Header().peersAt);
+    return std::vector<uint32_t>(peers + offsets[nodeId], peers + offsets[nodeId + 1]);
+}
+
+std::string_view CheckpointImage::Share(uint32_t shareId) const {
+    const uint64_t* offsets = Section<uint64_t>(Header().shareOffsetsAt);
+    const char* chars = Section<char>(Header().shareCharsAt);
+    return std::string_view(chars + offsets[shareId], offsets[shareId + 1] - offsets[shareId]);
+}
+
+// Points the seen tables and share names at the mapped file, copies the share
+// statistics, then re-schedules in-flight shares and mining events in their
+// original order. Nothing here is per (node, share), so a restore costs the
+// same however many receives led up to the checkpoint. Topology is applied by
+// main() while it creates the apps; `image` has to stay mapped for the run.
+void RestoreCheckpoint(const CheckpointImage& image, const std::vector<Ptr<MinerApp>>& minerApps) {
+    const CheckpointHeader& header = image.Header();
+
+    // A fresh table hands out the ids in file order
+    for (uint32_t s = 0; s < header.numShares; s++) {
+        GossipApp::shareIds.InternInPlace(image.Share(s));
+    }
+
+    const uint64_t* seenOffsets = image.Section<uint64_t>(header.seenOffsetsAt);
+    const uint32_t* seen = image.Section<uint32_t>(header.seenAt);
+    for (uint32_t i = 0; i < header.numNodes; i++) {
+        GossipApp::receivedShares[i].SetBase(seen + seenOffsets[i], seen + seenOffsets[i + 1]);
+    }
+    GossipApp::totalUniqueReceives = header.numSeen;
+
+    const CheckpointShare* shareTable = image.Section<CheckpointShare>(header.sharesAt);
+    GossipApp::shareStats.resize(header.numShares);
+    for (uint32_t s = 0; s < header.numShares; s++) {
+        const CheckpointShare& saved = shareTable[s];
+        ShareStats& stats = GossipApp::shareStats[s];
+        stats.origin = saved.origin;
+        stats.createdAt = saved.createdAt;
+        stats.receivers = saved.receivers;
+        stats.hopSum = saved.hopSum;
+        stats.messages = saved.messages;
+        stats.maxHop = saved.maxHop;
+        stats.lastReceiveAt = saved.lastReceiveAt;
+        stats.time50 = saved.time50;
+        stats.time90 = saved.time90;
+        stats.time100 = saved.time100;
+    }
+
+    const uint64_t* histograms = image.Section<uint64_t>(header.histogramsAt);
+    GossipApp::latencyHistogram.Deserialize(histograms);
+    GossipApp::hopHistogram.Deserialize(histograms + GossipApp::latencyHistogram.SerializedSize());
+
+    GossipApp::timeBase = header.time;
+    GossipApp::delayRng.SetState(header.delayRngState);
+
+    const CheckpointMiner* miners = image.Section<CheckpointMiner>(header.minersAt);
+    for (uint32_t i = 0; i < header.numNodes; i++) {
+        minerApps[i]->RestoreState(miners[i].rngState, miners[i].nextMineTime);
+    }
+
+    // Pending deliveries are stored in sequence order; merge the miners in
+    std::vector<uint32_t> minerOrder;
+    for (uint32_t i = 0; i < header.numNodes; i++) {
+        if (miners[i].nextMineTime >= 0) minerOrder.push_back(i);
+    }
+    std::sort(minerOrder.begin(), minerOrder.end(), [miners](uint32_t a, uint32_t b) {
+        return miners[a].sequence < miners[b].sequence;
+    });
+
+    const CheckpointPending* pending = image.Section<CheckpointPending>(header.pendingAt);
+    uint64_t p = 0;
+    size_t m = 0;
+    while (p < header.numPending || m < minerOrder.size()) {
+        if (m == minerOrder.size() || (p < header.numPending && pending[p].sequence < miners[minerOrder[m]].sequence)) {
+            GossipApp::ScheduleDelivery(pending[p].receiver, pending[p].sender, pending[p].share,
+                                        pending[p].hopCount, pending[p].time - header.time);
+            p++;
+        } else {
+            minerApps[minerOrder[m]]->ResumeMining();
+            m++;
+        }
+    }
+}
+
+// Compact end-of-run report built from the running share statistics, so its
+// cost depends on the number of shares, not on nodes x shares. Replay counters
+// are included when the shares came from a trace.
+void WriteSummary(std::ostream& os, uint32_t numNodes, uint64_t events, double simulatedTime, uint32_t topK,
+                  const TraceReplayer* replayer) {
+    uint32_t fullyPropagated = 0, partiallyPropagated = 0, minReceivers = numNodes;
+    double coverageSum = 0, time50Sum = 0, time90Sum = 0, time100Sum = 0;
+    uint32_t reached50 = 0, reached90 = 0;
+
+    SlowestShares slowest(topK);
+
+    for (uint32_t share = 0; share < GossipApp::shareStats.size(); share++) {
+        const ShareStats& stats = GossipApp::shareStats[share];
+        coverageSum += (double)stats.receivers / numNodes;
+        minReceivers = std::min(minReceivers, stats.receivers);
+        if (stats.time50 >= 0) { time50Sum += stats.time50; reached50++; }
+        if (stats.time90 >= 0) { time90Sum += stats.time90; reached90++; }
+        bool full = stats.time100 >= 0;
+        if (full) {
+            time100Sum += stats.time100;
+            fullyPropagated++;
+        } else {
+            partiallyPropagated++;
+        }
+
+        slowest.Offer(full, full ? stats.time100 : stats.lastReceiveAt - stats.createdAt, GossipApp::shareIds.Name(share), share);
+    }
+    std::vector<SlowestShares::Entry> top = slowest.Take();
+
+    size_t shares = GossipApp::shareStats.size();
+    auto mean = [](double sum, uint32_t n) { return n ? sum / n : 0.0; };
+    os << "{\n  \"nodes\": " << numNodes
+       << ",\n  \"events_executed\": " << events
+       << ",\n  \"simulated_time\": " << simulatedTime
+       << ",\n  \"shares\": " << shares
+       << ",\n  \"total_unique_receives\": " << GossipApp::totalUniqueReceives
+       << ",\n  \"fully_propagated\": " << fullyPropagated
+       << ",\n  \"partially_propagated\": " << partiallyPropagated
+       << ",\n  \"mean_coverage\": " << (shares ? coverageSum / shares : 0.0)
+       << ",\n  \"min_receivers\": " << (shares ? minReceivers : 0)
+       << ",\n  \"mean_time_to_50\": " << mean(time50Sum, reached50)
+       << ",\n  \"mean_time_to_90\": " << mean(time90Sum, reached90)
+       << ",\n  \"mean_time_to_100\": " << mean(time100Sum, fullyPropagated)
+       << ",\n  \"latency\": ";
+    GossipApp::latencyHistogram.WriteJson(os);
+    os << ",\n  \"hops\": ";
+    GossipApp::hopHistogram.WriteJson(os);
+    os << ",\n  \"slowest\": [";
+    for (size_t i = 0; i < top.size(); i++) {
+        const ShareStats& stats = GossipApp::shareStats[top[i].id];
+        os << (i ? "," : "") << "\n    {\"share\": \"" << top[i].name << "\", \"origin\": " << stats.origin
+           << ", \"receivers\": " << stats.receivers << ", \"complete\": " << (top[i].complete ? "true" : "false")
+           << ", \"time\": " << top[i].time << ", \"max_hop\": " << stats.maxHop << "}";
+    }
+    os << (top.empty() ? "]" : "\n  ]");
+    if (replayer) {
+        os << ",\n  \"replay\": ";
+        replayer->WriteJson(os);
+    }
+    os << "\n}\n";
+}
+
+// Per-node detail, only written when asked for
+void WriteNodeDetail(const std::string& path) {
+    std::ofstream out(path);
+    NS_ABORT_MSG_IF(!out, "Cannot open node detail file " << path);
+    out << "node,peers,shares_seen\n";
+    for (const auto& [node, peers] : GossipApp::peerList) {
+        out << node << "," << peers.size() << "," << GossipApp::receivedShares[node].Size() << "\n";
+    }
+}
+
+// Per-share outcomes of either model, in the form the validation report compares
+struct PropagationSample {
+    std::vector<double> time50;      // -1 if the share never got that far
+    std::vector<double> time90;
+    std::vector<double> time100;
+    std::vector<double> coverage;
+    std::vector<double> messages;
+    std::vector<uint32_t> seedOf;    // which estimate seed produced the share
+    Histogram latency{0.01, 3000};
+    Histogram hops{1.0, 64};
+    double wallSeconds = 0.0;
+};
+
+// Fast estimate of propagation without the event queue. A node forwards a share
+// once, on first receipt, with a freshly sampled delay per message, so first
+// arrival times are exactly shortest paths over per-edge delays drawn
+// independently for every share. Shares are solved kLanes at a time: delays and
+// labels are stored lane-contiguous, so each edge relaxation is one short loop
+// over lanes the compiler vectorizes. Delays come from a hash of (lane, edge),
+// so an edge relaxed again in a later round sees the same delay.
+class PropagationEstimator {
+public:
+    PropagationEstimator(const std::vector<std::vector<uint32_t>>& topology, const DelayModel& delays, uint32_t fanout)
+        : m_delays(delays), m_fanout(fanout), m_offsets{0} {
+        for (const auto& peers : topology) {
+            m_targets.insert(m_targets.end(), peers.begin(), peers.end());
+            m_offsets.push_back(m_targets.size());
+        }
+    }
+
+    // `shares` shares from random origins for each of `seeds` delay seeds
+    PropagationSample Run(uint32_t shares, uint32_t seeds, uint64_t seed) {
+        auto start = std::chrono::steady_clock::now();
+        PropagationSample sample;
+        std::vector<uint64_t> laneKeys;
+        std::vector<uint32_t> laneSeeds;
+        for (uint32_t s = 0; s < seeds; s++) {
+            GossipRng keys(seed * 0x100000001B3ULL + s);
+            for (uint32_t k = 0; k < shares; k++) {
+                laneKeys.push_back(keys.Next());
+                laneSeeds.push_back(s);
+                if (laneKeys.size() == kLanes) {
+                    SolveBlock(laneKeys, laneSeeds, sample);
+                    laneKeys.clear();
+                    laneSeeds.clear();
+                }
+            }
+        }
+        if (!laneKeys.empty()) {
+            SolveBlock(laneKeys, laneSeeds, sample);
+        }
+        sample.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return sample;
+    }
+
+private:
+    static const uint32_t kLanes = 16;
+
+    void SolveBlock(const std::vector<uint64_t>& laneKeys, const std::vector<uint32_t>& laneSeeds, PropagationSample& sample) {
+        const uint32_t numNodes = m_offsets.size() - 1;
+        const float inf = std::numeric_limits<float>::infinity();
+
+        // Delays of every edge in every lane; edges a node won't forward on are infinite
+        std::vector<float> delay(m_targets.size() * kLanes, inf);
+        std::vector<uint64_t> ranks, sorted;
+        for (uint32_t u = 0; u < numNodes; u++) {
+            uint64_t begin = m_offsets[u], end = m_offsets[u + 1];
+            // With a fanout, forward only on the `fanout` edges with the lowest rank.
+            // The event model excludes the sender first; here the choice can't
+            // depend on it, which is the one place the two models differ.
+            bool limited = m_fanout > 0 && m_fanout < end - begin;
+            for (uint32_t l = 0; l < laneKeys.size(); l++) {
+                ranks.clear();
+                for (uint64_t e = begin; e < end; e++) {
+                    // Salted with e + 1: the bare lane key is the origin's generator
+                    GossipRng rng(laneKeys[l] ^ ((e + 1) * 0xD1B54A32D192ED03ULL));
+                    delay[e * kLanes + l] = m_delays.FromBits(rng.Next());
+                    if (limited) ranks.push_back(rng.Next());
+                }
+                if (limited) {
+                    sorted = ranks;
+                    std::nth_element(sorted.begin(), sorted.begin() + m_fanout - 1, sorted.end());
+                    for (uint64_t e = begin; e < end; e++) {
+                        if (ranks[e - begin] > sorted[m_fanout - 1]) delay[e * kLanes + l] = inf;
+                    }
+                }
+            }
+        }
+
+        std::vector<double> dist(numNodes * kLanes, inf);
+        std::vector<uint16_t> hop(numNodes * kLanes, 0);
+        std::vector<uint32_t> parent(numNodes * kLanes, 0);
+        std::vector<uint32_t> origin(laneKeys.size());
+        std::vector<uint32_t> frontier, next;
+        std::vector<char> queued(numNodes, 0);
+        for (uint32_t l = 0; l < laneKeys.size(); l++) {
+            origin[l] = GossipRng(laneKeys[l]).Below(numNodes);
+            dist[origin[l] * kLanes + l] = 0.0;
+            parent[origin[l] * kLanes + l] = origin[l];
+            if (!queued[origin[l]]) {
+                queued[origin[l]] = 1;
+                frontier.push_back(origin[l]);
+            }
+        }
+
+        // Label-correcting rounds: only nodes improved in some lane last round relax again
+        while (!frontier.empty()) {
+            for (uint32_t u : frontier) queued[u] = 0;
+            next.clear();
+            for (uint32_t u : frontier) {
+                const double* du = &dist[u * kLanes];
+                const uint16_t* hu = &hop[u * kLanes];
+                for (uint64_t e = m_offsets[u]; e < m_offsets[u + 1]; e++) {
+                    uint32_t v = m_targets[e];
+                    const float* we = &delay[e * kLanes];
+                    double* dv = &dist[v * kLanes];
+                    uint16_t* hv = &hop[v * kLanes];
+                    uint32_t* pv = &parent[v * kLanes];
+                    bool improved = false;
+                    for (uint32_t l = 0; l < kLanes; l++) {
+                        double candidate = du[l] + we[l];
+                        bool better = candidate < dv[l];
+                        dv[l] = better ? candidate : dv[l];
+                        hv[l] = better ? hu[l] + 1 : hv[l];
+                        pv[l] = better ? u : pv[l];
+                        improved |= better;
+                    }
+                    if (improved && !queued[v]) {
+                        queued[v] = 1;
+                        next.push_back(v);
+                    }
+                }
+            }
+            frontier.swap(next);
+        }
+
+        // Same thresholds as ShareStats: half, 90% and all of the nodes, origin included
+        const uint32_t need50 = (numNodes + 1) / 2;
+        const uint32_t need90 = (9 * numNodes + 9) / 10;
+        std::vector<double> times;
+        for (uint32_t l = 0; l < laneKeys.size(); l++) {
+            times.clear();
+            uint64_t messages = 0;
+            for (uint32_t v = 0; v < numNodes; v++) {
+                double t = dist[v * kLanes + l];
+                if (t == inf) continue;
+                times.push_back(t);
+                sample.latency.Add(t);
+                sample.hops.Add(hop[v * kLanes + l]);
+                for (uint64_t e = m_offsets[v]; e < m_offsets[v + 1]; e++) {
+                    if (delay[e * kLanes + l] == inf) continue;
+                    if (v != origin[l] && m_targets[e] == parent[v * kLanes + l]) continue;
+                    messages++;
+                }
+            }
+            auto reachedBy = [&times](uint32_t need) {
+                if (need == 0 || times.size() < need) return -1.0;
+                std::nth_element(times.begin(), times.begin() + need - 1, times.end());
+                return times[need - 1];
+            };
+            sample.time50.push_back(reachedBy(need50));
+            sample.time90.push_back(reachedBy(need90));
+            sample.time100.push_back(reachedBy(numNodes));
+            sample.coverage.push_back((double)times.size() / numNodes);
+            sample.messages.push_back(messages);
+            sample.seedOf.push_back(laneSeeds[l]);
+        }
+    }
+
+    DelayModel m_delays;
+    uint32_t m_fanout;
+    std::vector<uint64_t> m_offsets;   // CSR form of the topology
+    std::vector<uint32_t> m_targets;
+};
+
+// What the event model measured for every share it ran
+PropagationSample CollectEventSample(uint32_t numNodes, double wallSeconds) {
+    PropagationSample sample;
+    std::vector<uint32_t> byName(GossipApp::shareStats.size());
+    for (uint32_t share = 0; share < byName.size(); share++) byName[share] = share;
+    std::sort(byName.begin(), byName.end(), [](uint32_t a, uint32_t b) {
+        return GossipApp::shareIds.Name(a) < GossipApp::shareIds.Name(b);
+    });
+    for (uint32_t share : byName) {
+        const ShareStats& stats = GossipApp::shareStats[share];
+        sample.time50.push_back(stats.time50);
+        sample.time90.push_back(stats.time90);
+        sample.time100.push_back(stats.time100);
+        sample.coverage.push_back((double)stats.receivers / numNodes);
+        sample.messages.push_back(stats.messages);
+        sample.seedOf.push_back(0);
+    }
+    sample.latency = GossipApp::latencyHistogram;
+    sample.hops = GossipApp::hopHistogram;
+    sample.wallSeconds = wallSeconds;
+    return sample;
+}
+
+struct Distribution {
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    size_t count = 0;    // values >= 0; negative ones mean "never"
+};
+
+Distribution Describe(std::vector<double> values) {
+    Distribution d;
+    values.erase(std::remove_if(values.begin(), values.end(), [](double v) { return v < 0; }), values.end());
+    if (values.empty()) return d;
+    std::sort(values.begin(), values.end());
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    d.mean = sum / values.size();
+    d.p50 = values[values.size() / 2];
+    d.p90 = values[std::min(values.size() - 1, values.size() * 9 / 10)];
+    d.count = values.size();
+    return d;
+}
+
+void WriteDistribution(std::ostream& os, const Distribution& d) {
+    if (d.count == 0) {
+        os << "{\"mean\": null, \"p50\": null, \"p90\": null, \"reached\": 0}";
+        return;
+    }
+    os << "{\"mean\": " << d.mean << ", \"p50\": " << d.p50 << ", \"p90\": " << d.p90 << ", \"reached\": " << d.count << "}";
+}
+
+void WriteSample(std::ostream& os, const PropagationSample& sample, uint32_t shareBytes, const std::string& indent) {
+    Distribution coverage = Describe(sample.coverage);
+    Distribution messages = Describe(sample.messages);
+    os << "{\n" << indent << "  \"shares\": " << sample.coverage.size()
+       << ",\n" << indent << "  \"wall_seconds\": " << sample.wallSeconds
+       << ",\n" << indent << "  \"mean_coverage\": " << coverage.mean
+       << ",\n" << indent << "  \"min_coverage\": "
+       << (sample.coverage.empty() ? 0.0 : *std::min_element(sample.coverage.begin(), sample.coverage.end()))
+       << ",\n" << indent << "  \"time_to_50\": ";
+    WriteDistribution(os, Describe(sample.time50));
+    os << ",\n" << indent << "  \"time_to_90\": ";
+    WriteDistribution(os, Describe(sample.time90));
+    os << ",\n" << indent << "  \"time_to_100\": ";
+    WriteDistribution(os, Describe(sample.time100));
+    os << ",\n" << indent << "  \"messages_per_share\": " << messages.mean;
+    if (shareBytes > 0) {
+        os << ",\n" << indent << "  \"bytes_per_share\": " << messages.mean * shareBytes;
+    }
+
+    // Spread between independent delay seeds says whether there were enough shares
+    uint32_t seeds = sample.seedOf.empty() ? 0 : *std::max_element(sample.seedOf.begin(), sample.seedOf.end()) + 1;
+    if (seeds > 1) {
+        std::vector<std::vector<double>> perSeed(seeds);
+        for (size_t i = 0; i < sample.time90.size(); i++) {
+            perSeed[sample.seedOf[i]].push_back(sample.time90[i]);
+        }
+        double lo = std::numeric_limits<double>::infinity(), hi = 0.0;
+        for (const auto& values : perSeed) {
+            Distribution d = Describe(values);
+            if (d.count == 0) continue;
+            lo = std::min(lo, d.mean);
+            hi = std::max(hi, d.mean);
+        }
+        if (hi > 0.0) {
+            os << ",\n" << indent << "  \"seed_spread_time_to_90\": {\"min\": " << lo << ", \"max\": " << hi << "}";
+        }
+    }
+    os << ",\n" << indent << "  \"latency\": ";
+    sample.latency.WriteJson(os);
+    os << ",\n" << indent << "  \"hops\": ";
+    sample.hops.WriteJson(os);
+    os << "\n" << indent << "}";
+}
+
+// Largest gap between the two empirical CDFs; "never" sorts after every time
+double KolmogorovSmirnov(std::vector<double> a, std::vector<double> b) {
+    auto normalize = [](std::vector<double>& v) {
+        for (double& x : v) {
+            if (x < 0) x = std::numeric_limits<double>::infinity();
+        }
+        std::sort(v.begin(), v.end());
+    };
+    normalize(a);
+    normalize(b);
+    if (a.empty() || b.empty()) return 0.0;
+
+    double gap = 0.0;
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        double x = std::min(a[i], b[j]);
+        while (i < a.size() && a[i] <= x) i++;
+        while (j < b.size() && b[j] <= x) j++;
+        gap = std::max(gap, std::fabs((double)i / a.size() - (double)j / b.size()));
+    }
+    return gap;
+}
+
+// Estimate vs. event model on the same topology and delay model. A metric is
+// "within" when the relative error is at most `tolerance`.
+void WriteValidation(std::ostream& os, const PropagationSample& estimate, const PropagationSample& events,
+                     uint64_t eventsExecuted, uint32_t shareBytes, double tolerance) {
+    struct Metric {
+        const char* name;
+        double estimate;
+        double events;
+    };
+    std::vector<Metric> metrics = {
+        {"mean_coverage", Describe(estimate.coverage).mean, Describe(events.coverage).mean},
+        {"mean_hops", estimate.hops.Mean(), events.hops.Mean()},
+        {"messages_per_share", Describe(estimate.messages).mean, Describe(events.messages).mean},
+    };
+    // Coverage times only mean something if both models got there for some shares
+    auto addTimes = [&metrics](const char* mean, const char* p90, const std::vector<double>& a, const std::vector<double>& b) {
+        Distribution da = Describe(a), db = Describe(b);
+        if (da.count == 0 || db.count == 0) return;
+        metrics.push_back({mean, da.mean, db.mean});
+        if (p90) metrics.push_back({p90, da.p90, db.p90});
+    };
+    addTimes("time_to_50_mean", nullptr, estimate.time50, events.time50);
+    addTimes("time_to_90_mean", nullptr, estimate.time90, events.time90);
+    addTimes("time_to_100_mean", "time_to_100_p90", estimate.time100, events.time100);
+
+    uint32_t within = 0;
+    os << "{\n  \"events_executed\": " << eventsExecuted << ",\n  \"estimate\": ";
+    WriteSample(os, estimate, shareBytes, "  ");
+    os << ",\n  \"event_model\": ";
+    WriteSample(os, events, shareBytes, "  ");
+    os << ",\n  \"comparison\": {";
+    for (size_t i = 0; i < metrics.size(); i++) {
+        const Metric& m = metrics[i];
+        double error = m.events != 0 ? std::fabs(m.estimate - m.events) / std::fabs(m.events) : std::fabs(m.estimate);
+        bool ok = error <= tolerance;
+        within += ok;
+        os << (i ? "," : "") << "\n    \"" << m.name << "\": {\"estimate\": " << m.estimate << ", \"event_model\": " << m.events
+           << ", \"relative_error\": " << error << ", \"within\": " << (ok ? "true" : "false") << "}";
+    }
+    double perShareEstimate = estimate.wallSeconds / std::max<size_t>(estimate.coverage.size(), 1);
+    double perShareEvents = events.wallSeconds / std::max<size_t>(events.coverage.size(), 1);
+    os << "\n  },\n  \"ks_time_to_100\": " << KolmogorovSmirnov(estimate.time100, events.time100)
+       << ",\n  \"tolerance\": " << tolerance
+       << ",\n  \"metrics_within\": " << within << ",\n  \"metrics\": " << metrics.size()
+       << ",\n  \"speedup_per_share\": " << (perShareEstimate > 0 ? perShareEvents / perShareEstimate : 0.0)
+       << "\n}\n";
+}
+
 int main(int argc, char *argv[]) {
     uint32_t numNodes = 1000;
     uint32_t numPeers = 8;
     double stopTime = 20.0;
+    uint32_t seed = 1;
+    double checkpointAt = -1.0;
+    std::string checkpointFile = "gossip.ckpt";
+    std::string restoreFrom;
+    int32_t forkShare = -1;
+    std::string trace;
+    uint32_t traceLookahead = 64;
+    double replaySpeed = 1.0;
+    double replayStart = 0.0;
+    std::string minerMap = "hash";
+    std::string summaryFile;
+    std::string nodeDetail;
+    uint32_t topK = 10;
+    std::string mode = "simulate";
+    std::string jitter = "uniform";
+    uint32_t estimateShares = 256;
+    uint32_t estimateSeeds = 4;
+    uint32_t validateShares = 200;
+    double validateSpacing = 0.5;
+    double tolerance = 0.05;
+    uint32_t shareBytes = 0;
 
     CommandLine cmd;
     cmd.AddValue("nodes", "Number of nodes", numNodes);
+    cmd.AddValue("peers", "Peers each node forwards to", numPeers);
+    cmd.AddValue("seed", "Random seed", seed);
+    cmd.AddValue("mode", "simulate (event model), estimate (shortest-path estimate only) or validate (both, compared)", mode);
+    cmd.AddValue("fanout", "Forward to this many random peers instead of all of them (0 = all)", GossipApp::fanout);
+    cmd.AddValue("baseDelay", "Fixed part of every message delay in seconds", GossipApp::delayModel.base);
+    cmd.AddValue("jitter", "Delay jitter distribution: uniform or exponential", jitter);
+    cmd.AddValue("jitterScale", "Uniform jitter is below this many seconds; exponential jitter has mean jitterScale/2", GossipApp::delayModel.scale);
+    cmd.AddValue("estimateShares", "Shares per seed in the estimate", estimateShares);
+    cmd.AddValue("estimateSeeds", "Independent delay seeds in the estimate", estimateSeeds);
+    cmd.AddValue("validateShares", "Shares the event model runs in validate mode", validateShares);
+    cmd.AddValue("validateSpacing", "Seconds between those shares", validateSpacing);
+    cmd.AddValue("tolerance", "Relative error the validation report accepts", tolerance);
+    cmd.AddValue("shareBytes", "Share size for the bytes-per-share estimate (0 leaves it out)", shareBytes);
+    cmd.AddValue("stopTime", "Simulation stop time in seconds", stopTime);
+    cmd.AddValue("checkpointAt", "Write a checkpoint at this simulated time (negative disables)", checkpointAt);
+    cmd.AddValue("checkpointFile", "Where to write the checkpoint", checkpointFile);
+    cmd.AddValue("restore", "Continue from this checkpoint instead of building a new network", restoreFrom);
+    cmd.AddValue("forkShare", "After restoring, this node finds a share right away (-1 disables)", forkShare);
+    cmd.AddValue("trace", "Replay shares from this CSV (timestamp,miner,size,parent) instead of random mining", trace);
+    cmd.AddValue("traceLookahead", "Trace records buffered in memory", traceLookahead);
+    cmd.AddValue("replaySpeed", "Trace time is divided by this (2 = twice as fast)", replaySpeed);
+    cmd.AddValue("replayStart", "Simulated time at which the first trace record is sent", replayStart);
+    cmd.AddValue("minerMap", "How trace miners map to nodes: hash, roundrobin or file:<path> with miner,node lines", minerMap);
+    cmd.AddValue("summary", "Write the JSON run summary to this file instead of stdout", summaryFile);
+    cmd.AddValue("topK", "Number of slowest shares listed in the summary", topK);
+    cmd.AddValue("nodeDetail", "Also write a per-node CSV to this file", nodeDetail);
     cmd.Parse(argc, argv);
 
+    bool replaying = !trace.empty();
+    NS_ABORT_MSG_IF(replaying && (checkpointAt >= 0 || !restoreFrom.empty()),
+                    "Trace replay position is not part of a checkpoint, use one or the other");
+    NS_ABORT_MSG_IF(mode != "simulate" && mode != "estimate" && mode != "validate", "Unknown mode " << mode);
+    NS_ABORT_MSG_IF(mode != "simulate" && (replaying || checkpointAt >= 0 || !restoreFrom.empty()),
+                    "estimate and validate modes run their own shares on a fresh network");
+    NS_ABORT_MSG_IF(jitter != "uniform" && jitter != "exponential", "Unknown jitter distribution " << jitter);
+    NS_ABORT_MSG_IF(restoreFrom.empty() && numPeers >= numNodes, "peers must be fewer than nodes");
+    GossipApp::delayModel.exponential = jitter == "exponential";
+
+    srand(seed);
+    RngSeedManager::SetSeed(seed);
+    GossipApp::delayRng.SetState(seed);
+    GossipApp::trackPending = checkpointAt >= 0;
+
+    CheckpointImage image;
+    bool restoring = !restoreFrom.empty();
+    if (restoring) {
+        image.Open(restoreFrom);
+        numNodes = image.Header().numNodes;
+        NS_ABORT_MSG_IF(stopTime <= image.Header().time, "stopTime must be later than the checkpoint time " << image.Header().time);
+    }
+
+    GossipApp::networkSize = numNodes;
+    GossipApp::receivedShares.resize(numNodes);
+    std::vector<std::vector<uint32_t>> topology(numNodes);
+    if (restoring) {
+        for (uint32_t i = 0; i < numNodes; ++i) {
+            topology[i] = image.Peers(i);
+        }
+    } else {
+        topology = BuildTopology(numNodes, numPeers);
+    }
+
+    std::ofstream summaryOut;
+    if (!summaryFile.empty()) {
+        summaryOut.open(summaryFile);
+        NS_ABORT_MSG_IF(!summaryOut, "Cannot open summary file " << summaryFile);
+    }
+    std::ostream& summary = summaryFile.empty() ? std::cout : summaryOut;
+
+    PropagationSample estimate;
+    if (mode != "simulate") {
+        PropagationEstimator estimator(topology, GossipApp::delayModel, GossipApp::fanout);
+        estimate = estimator.Run(estimateShares, estimateSeeds, seed);
+    }
+    if (mode == "estimate") {
+        WriteSample(summary, estimate, shareBytes, "");
+        summary << "\n";
+        return 0;
+    }
+    bool validating = mode == "validate";
+
     NodeContainer nodes;
     nodes.Create(numNodes);
 
     std::vector<Ptr<GossipApp>> gossipApps(numNodes);
+    std::vector<Ptr<MinerApp>> minerApps(numNodes);
 
     for (uint32_t i = 0; i < numNodes; ++i) {
-        std::unordered_set<uint32_t> peers;
-        while (peers.size() < numPeers) {
-            uint32_t peer = rand() % numNodes;
-            if (peer != i) peers.insert(peer);
-        }
-
         Ptr<GossipApp> gossip = CreateObject<GossipApp>();
-        gossip->Setup(i, nodes.Get(i), std::vector<uint32_t>(peers.begin(), peers.end()));
+        gossip->Setup(i, nodes.Get(i), topology[i]);
         nodes.Get(i)->AddApplication(gossip);
         gossipApps[i] = gossip;
 
         Ptr<MinerApp> miner = CreateObject<MinerApp>();
-        miner->Setup(i, gossip);
-        nodes.Get(i)->AddApplication(miner);
+        miner->Setup(i, gossip, seed);
+        // Replayed traces and validation shares replace the random miners
+        if (!replaying && !validating) {
+            nodes.Get(i)->AddApplication(miner);
+        }
+        minerApps[i] = miner;
     }
 
-    Simulator::Stop(Seconds(stopTime));
-    Simulator::Run();
-    Simulator::Destroy();
+    if (restoring) {
+        RestoreCheckpoint(image, minerApps);
+        std::cerr << "Restored " << numNodes << " nodes from " << restoreFrom << " at t=" << GossipApp::timeBase << "s\n";
 
-    std::cout << "\n==== Simulation Summary ====\n";
-    std::cout << "Total unique share receives across all nodes: " << GossipApp::totalUniqueReceives << "\n";
-    std::cout << "Shares received by number of nodes:\n";
-    for (const auto& [share, receivers] : GossipApp::shareReceivers) {
-        std::cout << share << " reached " << receivers.size() << " nodes\n";
+        if (forkShare >= 0 && static_cast<uint32_t>(forkShare) < numNodes) {
+            std::string share = ShareName(forkShare, GossipApp::timeBase) + "_fork";
+            Simulator::ScheduleNow(&GossipApp::SendShare, gossipApps[forkShare], share);
+        }
     }
 
-    std::cout << "\n==== Propagation Report ====\n";
-    uint32_t fullyPropagated = 0, partiallyPropagated = 0;
-    for (const auto& [share, receivers] : GossipApp::shareReceivers) {
-        if (receivers.size() == numNodes) {
-            std::cout << "[FULL ✅] " << share << " reached all " << numNodes << " nodes.\n";
-            fullyPropagated++;
-        } else {
-            std::cout << "[PARTIAL ❌] " << share << " reached only " << receivers.size() << "/" << numNodes << " nodes.\n";
-            partiallyPropagated++;
+    std::unique_ptr<TraceReplayer> replayer;
+    if (replaying) {
+        replayer = std::make_unique<TraceReplayer>(trace, traceLookahead, replaySpeed, minerMap, gossipApps);
+        replayer->Start(replayStart);
+    }
+
+    if (checkpointAt >= 0) {
+        Simulator::Schedule(Seconds(checkpointAt - GossipApp::timeBase), &WriteCheckpoint, checkpointFile, minerApps);
+    }
+
+    // Validation shares run until the last delivery, so none is cut off by stopTime
+    if (validating) {
+        GossipRng origins(seed ^ 0x5DEECE66DULL);
+        for (uint32_t k = 0; k < validateShares; k++) {
+            uint32_t origin = origins.Below(numNodes);
+            std::string share = "Share_" + std::to_string(origin) + "_" + std::to_string(k) + "_validate";
+            Simulator::Schedule(Seconds(k * validateSpacing), &GossipApp::SendShare, gossipApps[origin], share);
         }
+    } else {
+        Simulator::Stop(Seconds(stopTime - GossipApp::timeBase));
     }
-    std::cout << "\nShares fully propagated: " << fullyPropagated << "\n";
-    std::cout << "Shares partially propagated: " << partiallyPropagated << "\n";
+    auto wallStart = std::chrono::steady_clock::now();
+    Simulator::Run();
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    // stdout carries only the JSON report, anything else goes to stderr
+    uint64_t eventsExecuted = Simulator::GetEventCount();
+    double simulatedTime = GossipApp::Now();
+    Simulator::Destroy();
 
-    std::cout << "\n==== Average Hop Report ====\n";
-    for (const auto& [share, hops] : GossipApp::shareHopCounts) {
-        double total = 0;
-        for (uint32_t h : hops) total += h;
-        std::cout << share << " average hop count: " << (total / hops.size()) << "\n";
+    if (validating) {
+        WriteValidation(summary, estimate, CollectEventSample(numNodes, wallSeconds), eventsExecuted, shareBytes,
+                        tolerance);
+    } else {
+        WriteSummary(summary, numNodes, eventsExecuted, simulatedTime, topK, replayer.get());
+    }
+    if (!nodeDetail.empty()) {
+        WriteNodeDetail(nodeDetail);
     }
 
     return 0;
@@ -0,0 +1,139 @@
+// Per-share work of the gossip simulations: naming shares, interning the names,
+// the per-node "seen" tables and splitting received bytes into frames.
+// GossipBenchmark times these same functions, so a change here shows up in its
+// numbers.
+
+#ifndef GOSSIP_HOT_PATH_H
+#define GOSSIP_HOT_PATH_H
+
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// "Block_<counter>_<node>", the names Gossip_with_miners gives mined blocks
+inline std::string BlockName(uint32_t counter, uint32_t nodeId) {
+    return "Block_" + std::to_string(counter) + "_" + std::to_string(nodeId);
+}
+
+// "Share_<node>_<time>", the names ScheduleWithContext gives mined shares
+inline std::string ShareName(uint32_t nodeId, double time) {
+    return "Share_" + std::to_string(nodeId) + "_" + std::to_string(time);
+}
+
+// Gives every distinct share name a dense 32-bit id, so per-node tables and
+// scheduled events carry an integer instead of a copy of the name
+class ShareIds {
+public:
+    // Id of `name`, the next free one if it hasn't been seen before
+    uint32_t Intern(std::string_view name) {
+        auto it = m_index.find(name);
+        if (it != m_index.end()) return it->second;
+
+        m_owned.emplace_back(name);
+        return Add(m_owned.back());
+    }
+
+    // Same, but a new name is not copied: its storage (e.g. a mapped checkpoint)
+    // must outlive the table
+    uint32_t InternInPlace(std::string_view name) {
+        auto it = m_index.find(name);
+        return it != m_index.end() ? it->second : Add(name);
+    }
+
+    std::string_view Name(uint32_t id) const { return m_names[id]; }
+
+    uint32_t Size() const { return m_names.size(); }
+
+private:
+    uint32_t Add(std::string_view name) {
+        uint32_t id = m_names.size();
+        m_names.push_back(name);
+        m_index.emplace(name, id);
+        return id;
+    }
+
+    std::deque<std::string> m_owned;   // a deque never moves its elements, so views stay valid
+    std::vector<std::string_view> m_names;
+    std::unordered_map<std::string_view, uint32_t> m_index;
+};
+
+// Shares one node has seen, by interned id. A restored node starts from a
+// sorted id range that is read where it lies (the mapped checkpoint); only
+// shares received after that go into the hash set.
+class SeenShares {
+public:
+    // False if `id` was already there
+    bool Insert(uint32_t id) { return !InBase(id) && m_ids.insert(id).second; }
+
+    bool Contains(uint32_t id) const { return InBase(id) || m_ids.count(id) > 0; }
+
+    size_t Size() const { return (m_baseEnd - m_baseBegin) + m_ids.size(); }
+
+    // `[begin, end)` is sorted and outlives the table
+    void SetBase(const uint32_t* begin, const uint32_t* end) {
+        m_baseBegin = begin;
+        m_baseEnd = end;
+    }
+
+    template <typename F>
+    void ForEach(F&& f) const {
+        for (const uint32_t* id = m_baseBegin; id != m_baseEnd; ++id) f(*id);
+        for (uint32_t id : m_ids) f(id);
+    }
+
+private:
+    bool InBase(uint32_t id) const {
+        return m_baseBegin != m_baseEnd && std::binary_search(m_baseBegin, m_baseEnd, id);
+    }
+
+    const uint32_t* m_baseBegin = nullptr;
+    const uint32_t* m_baseEnd = nullptr;
+    std::unordered_set<uint32_t> m_ids;
+};
+
+// Appends the bytes of `packet` to a connection's receive buffer
+inline uint32_t AppendPayload(std::string& buffer, ns3::Ptr<ns3::Packet> packet) {
+    uint32_t size = packet->GetSize();
+    size_t end = buffer.size();
+    buffer.resize(end + size);
+    packet->CopyData(reinterpret_cast<uint8_t*>(&buffer[end]), size);
+    return size;
+}
+
+// Complete newline-terminated frames from the front of `buffer`
+inline std::vector<std::string> TakeFrames(std::string& buffer) {
+    std::vector<std::string> frames;
+    size_t start = 0;
+    size_t end;
+    while ((end = buffer.find('\n', start)) != std::string::npos) {
+        frames.push_back(buffer.substr(start, end - start));
+        start = end + 1;
+    }
+    buffer.erase(0, start);
+    return frames;
+}
+
+// Random directed overlay: every node picks `numPeers` distinct peers other than itself
+inline std::vector<std::vector<uint32_t>> BuildTopology(uint32_t numNodes, uint32_t numPeers) {
+    std::vector<std::vector<uint32_t>> topology(numNodes);
+    for (uint32_t i = 0; i < numNodes; ++i) {
+        std::unordered_set<uint32_t> peers;
+        while (peers.size() < numPeers) {
+            uint32_t peer = rand() % numNodes;
+            if (peer != i) peers.insert(peer);
+        }
+        topology[i].assign(peers.begin(), peers.end());
+    }
+    return topology;
+}
+
+#endif // GOSSIP_HOT_PATH_H
@@ -0,0 +1,128 @@
+// Run-summary statistics shared by the gossip simulations: a fixed-width
+// histogram and the list of slowest shares.
+
+#ifndef GOSSIP_STATS_H
+#define GOSSIP_STATS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+// Fixed-width buckets from 0, with everything past the last bucket counted as overflow
+class Histogram {
+public:
+    Histogram(double bucketWidth, uint32_t buckets) : m_width(bucketWidth), m_counts(buckets, 0) {}
+
+    void Add(double value) {
+        uint64_t bucket = value < 0 ? 0 : static_cast<uint64_t>(value / m_width);
+        if (bucket < m_counts.size()) {
+            m_counts[bucket]++;
+        } else {
+            m_overflow++;
+        }
+        m_total++;
+        m_sum += value;
+    }
+
+    double Mean() const { return m_total ? m_sum / m_total : 0.0; }
+
+    // Upper edge of the bucket holding the p-th sample
+    double Percentile(double p) const {
+        uint64_t rank = static_cast<uint64_t>(p * m_total);
+        uint64_t seen = 0;
+        for (size_t b = 0; b < m_counts.size(); b++) {
+            seen += m_counts[b];
+            if (seen > rank) return (b + 1) * m_width;
+        }
+        return m_counts.size() * m_width;
+    }
+
+    void WriteJson(std::ostream& os) const {
+        size_t used = m_counts.size();
+        while (used > 0 && m_counts[used - 1] == 0) used--;
+        os << "{\"bucket_width\": " << m_width << ", \"samples\": " << m_total << ", \"mean\": " << Mean()
+           << ", \"p50\": " << Percentile(0.5) << ", \"p90\": " << Percentile(0.9) << ", \"p99\": " << Percentile(0.99)
+           << ", \"overflow\": " << m_overflow << ", \"counts\": [";
+        for (size_t b = 0; b < used; b++) {
+            os << (b ? ", " : "") << m_counts[b];
+        }
+        os << "]}";
+    }
+
+    // Flat representation used by checkpoints: overflow, total, sum bits, counts
+    std::vector<uint64_t> Serialize() const {
+        std::vector<uint64_t> out{m_overflow, m_total, 0};
+        std::memcpy(&out[2], &m_sum, sizeof(double));
+        out.insert(out.end(), m_counts.begin(), m_counts.end());
+        return out;
+    }
+
+    void Deserialize(const uint64_t* data) {
+        m_overflow = data[0];
+        m_total = data[1];
+        std::memcpy(&m_sum, &data[2], sizeof(double));
+        std::copy(data + 3, data + 3 + m_counts.size(), m_counts.begin());
+    }
+
+    size_t SerializedSize() const { return 3 + m_counts.size(); }
+
+private:
+    double m_width;
+    std::vector<uint64_t> m_counts;
+    uint64_t m_overflow = 0;
+    uint64_t m_total = 0;
+    double m_sum = 0.0;
+};
+
+// The `k` slowest of the shares offered, kept in a k-sized heap so a summary
+// costs O(shares log k). Shares that never reached every node rank first, then
+// by time (to full coverage, or to the last receive); ties go by name so the
+// output is stable.
+class SlowestShares {
+public:
+    struct Entry {
+        bool complete;
+        double time;
+        std::string_view name;
+        uint32_t id;
+    };
+
+    explicit SlowestShares(uint32_t k) : m_k(k) {}
+
+    void Offer(bool complete, double time, std::string_view name, uint32_t id) {
+        if (m_k == 0) return;
+        Entry entry{complete, time, name, id};
+        if (m_heap.size() < m_k) {
+            m_heap.push_back(entry);
+            std::push_heap(m_heap.begin(), m_heap.end(), Slower);
+        } else if (Slower(entry, m_heap.front())) {
+            // The front is the fastest share kept
+            std::pop_heap(m_heap.begin(), m_heap.end(), Slower);
+            m_heap.back() = entry;
+            std::push_heap(m_heap.begin(), m_heap.end(), Slower);
+        }
+    }
+
+    // Slowest first; leaves the list empty
+    std::vector<Entry> Take() {
+        std::sort_heap(m_heap.begin(), m_heap.end(), Slower);
+        std::vector<Entry> top;
+        top.swap(m_heap);
+        return top;
+    }
+
+private:
+    static bool Slower(const Entry& a, const Entry& b) {
+        if (a.complete != b.complete) return !a.complete;
+        if (a.time != b.time) return a.time > b.time;
+        return a.name < b.name;
+    }
+
+    uint32_t m_k;
+    std::vector<Entry> m_heap;
+};
+
+#endif // GOSSIP_STATS_H